@@ -0,0 +1,140 @@
+#!/bin/bash
+
+# Measures how fast quash runs short commands. A script of COUNT copies of
+# COMMAND (an external command that exits immediately by default, or a builtin
+# such as echo) is run through every quash binary given on the command line
+# (./quash by default) and the rate is reported for each. With -o the results
+# are also appended to a tab separated file under the name given by -l, along
+# with the run they belong to and the git revision measured, so the file keeps
+# the history of every run.
+
+if [ ! -e "$0" ]; then
+    echo "This script must be run from its directory"
+    exit 1
+fi
+
+TOP_DIR=$(cd "$(dirname "$0")/.." && pwd)
+
+COUNT=10000
+COMMAND=/bin/true
+AS_ARG=false
+LABEL=
+RESULTS=
+RUN=$(date +%Y-%m-%dT%H:%M:%S)
+
+usage() {
+    printf "Usage: $0 [-n count] [-c command] [-a] [-l label] [-r run] [-o file] [quash binary ...]\n" 1>&2
+    printf "\tn - Number of commands to run (default $COUNT)\n" 1>&2
+    printf "\tc - Command line to repeat (default $COMMAND)\n" 1>&2
+    printf "\ta - Pass the script as an argument rather than on stdin\n" 1>&2
+    printf "\tl - Name of the benchmark in the results file (default the command)\n" 1>&2
+    printf "\tr - Name of the run in the results file (default the current time)\n" 1>&2
+    printf "\to - Append the results to this tab separated file\n" 1>&2
+    exit 1
+}
+
+# Current time in nanoseconds
+# RETURN: Nanoseconds since the epoch
+now_ns() {
+    date +%s%N
+}
+
+# Time one quash binary over a script
+# RETURN: Elapsed nanoseconds
+time_quash() {
+    # $1 - Quash binary to run
+    # $2 - Script to feed it
+
+    local __quash="$1"
+    local __script="$2"
+
+    local start=$(now_ns)
+    if $AS_ARG; then
+        "$__quash" "$__script" > /dev/null
+    else
+        "$__quash" < "$__script" > /dev/null
+    fi
+    local end=$(now_ns)
+
+    echo $((end - start))
+}
+
+## Parse options
+while getopts "n:c:al:r:o:" o; do
+    case "${o}" in
+        n)
+            COUNT=${OPTARG}
+            ;;
+
+        c)
+            COMMAND=${OPTARG}
+            ;;
+
+        a)
+            AS_ARG=true
+            ;;
+
+        l)
+            LABEL=${OPTARG}
+            ;;
+
+        r)
+            RUN=${OPTARG}
+            ;;
+
+        o)
+            RESULTS=${OPTARG}
+            ;;
+
+        *)
+            usage
+            ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ -z "$LABEL" ]; then
+    LABEL=$COMMAND
+fi
+
+BINARIES=("$@")
+if [ ${#BINARIES[@]} -eq 0 ]; then
+    BINARIES=("$TOP_DIR/quash")
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+## Generate the script. The default command is an absolute path so only
+## process creation is measured
+SCRIPT=$TMP_DIR/spawn.qsh
+for ((i = 0; i < COUNT; ++i)); do
+    echo "$COMMAND"
+done > $SCRIPT
+
+## Start the results file with a header the first time
+if [ -n "$RESULTS" ] && [ ! -s "$RESULTS" ]; then
+    printf "run\trevision\tbenchmark\tbinary\tinput\tcommands\tseconds\tcommands_per_s\n" > "$RESULTS"
+fi
+
+REVISION=$(git -C "$TOP_DIR" describe --always --dirty 2>/dev/null || echo unknown)
+
+if $AS_ARG; then
+    INPUT=argument
+else
+    INPUT=stdin
+fi
+
+## Run every binary over the script
+printf "%-40s %10s %12s\n" "binary" "seconds" "commands/s"
+for Q in "${BINARIES[@]}"; do
+    ELAPSED=$(time_quash "$Q" $SCRIPT)
+    awk -v q="$Q" -v ns=$ELAPSED -v n=$COUNT \
+        'BEGIN { printf "%-40s %10.3f %12.0f\n", q, ns / 1e9, n / (ns / 1e9) }'
+
+    if [ -n "$RESULTS" ]; then
+        awk -v r="$RUN" -v v="$REVISION" -v l="$LABEL" -v q="$Q" -v i=$INPUT -v ns=$ELAPSED -v n=$COUNT \
+            'BEGIN { printf "%s\t%s\t%s\t%s\t%s\t%d\t%.6f\t%.1f\n", r, v, l, q, i, n, ns / 1e9, n / (ns / 1e9) }' \
+            >> "$RESULTS"
+    fi
+done
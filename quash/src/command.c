@@ -109,6 +109,30 @@ Command mk_jobs_command() {
   return cmd;
 }
 
+// Create HashCommand structure
+Command mk_hash_command(char** args) {
+  Command cmd;
+
+  cmd.hash = (HashCommand) {
+    HASH,
+    args
+  };
+
+  return cmd;
+}
+
+// Create JobControlCommand structure
+Command mk_job_control_command(CommandType type, char** args) {
+  Command cmd;
+
+  cmd.job_ctl = (JobControlCommand) {
+    type,
+    args
+  };
+
+  return cmd;
+}
+
 // Create ExitCommand structure
 Command mk_exit_command() {
   Command cmd;
@@ -201,6 +225,22 @@ static void __print_command(Command cmd) {
     __print_simple_cmd("JOBS");
     break;
 
+  case HASH:
+    __print_simple_cmd("HASH");
+    break;
+
+  case FG:
+    __print_simple_cmd("FG");
+    break;
+
+  case BG:
+    __print_simple_cmd("BG");
+    break;
+
+  case WAIT:
+    __print_simple_cmd("WAIT");
+    break;
+
   case EXIT:
     __print_simple_cmd("EXIT");
     break;
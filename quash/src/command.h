@@ -45,7 +45,14 @@
  * @brief Flag bit indicating whether a @a GenericCommand should be run in
  * the background
  */
+/**
+ * @def TIMED
+ *
+ * @brief Flag bit indicating whether the job of a command was prefixed with
+ * time and should report the time and resources it used
+ */
 #define REDIRECT_IN     (0x01)
+#define TIMED           (0x02)
 #define REDIRECT_OUT    (0x04)
 #define REDIRECT_APPEND (0x08)
 #define PIPE_IN         (0x10)
@@ -69,6 +76,10 @@ typedef enum CommandType {
   CD,
   PWD,
   JOBS,
+  HASH,
+  FG,
+  BG,
+  WAIT,
   EXIT
 } CommandType;
 
@@ -160,6 +171,27 @@ typedef SimpleCommand PWDCommand;
  */
 typedef SimpleCommand JobsCommand;
 
+/**
+ * @brief Alias for @a GenericCommand to denote a command to inspect or clear
+ * the table of resolved command paths
+ *
+ * @note The args array holds the arguments after the word `hash`
+ *
+ * @sa GenericCommand, Command
+ */
+typedef GenericCommand HashCommand;
+
+/**
+ * @brief Alias for @a GenericCommand to denote a job control command (fg, bg
+ * or wait), told apart by its @a CommandType
+ *
+ * @note The args array holds the arguments after the command name. The only
+ * argument used is an optional job id, with or without a leading '%'.
+ *
+ * @sa GenericCommand, Command
+ */
+typedef GenericCommand JobControlCommand;
+
 /**
  * @brief Alias for @a SimpleCommand to denote a termination of the program
  *
@@ -182,8 +214,8 @@ typedef SimpleCommand EOCCommand;
  * get_command_type() function.
  *
  * @sa get_command_type, SimpleCommand, GenericCommand, EchoCommand,
- * ExportCommand, CDCommand, KillCommand, PWDCommand, JobsCommand, ExitCommand,
- * EOCCommand
+ * ExportCommand, CDCommand, KillCommand, PWDCommand, JobsCommand, HashCommand,
+ * JobControlCommand, ExitCommand, EOCCommand
  */
 typedef union Command {
   SimpleCommand simple;   /**< Read structure as a @a SimpleCommand */
@@ -194,6 +226,8 @@ typedef union Command {
   KillCommand kill;       /**< Read structure as a @a KillCommand */
   PWDCommand pwd;         /**< Read structure as a @a PWDCommand */
   JobsCommand jobs;       /**< Read structure as a @a JobsCommand */
+  HashCommand hash;       /**< Read structure as a @a HashCommand */
+  JobControlCommand job_ctl; /**< Read structure as a @a JobControlCommand */
   ExitCommand exit;       /**< Read structure as a @a ExitCommand */
   EOCCommand eoc;         /**< Read structure as a @a EOCCommand */
 } Command;
@@ -217,7 +251,8 @@ typedef struct CommandHolder {
                        *   - @a REDIRECT_APPEND
                        *   - @a PIPE_IN
                        *   - @a PIPE_OUT
-                       *   - @a BACKGROUND */
+                       *   - @a BACKGROUND
+                       *   - @a TIMED */
   Command cmd;        /**< A @a Command to hold */
 } CommandHolder;
 
@@ -243,6 +278,7 @@ typedef struct CommandHolder {
  *   - @a PIPE_IN
  *   - @a PIPE_OUT
  *   - @a BACKGROUND
+ *   - @a TIMED
  *
  * @param cmd The @a Command the CommandHolder should copy and hold on to
  *
@@ -332,6 +368,32 @@ Command mk_pwd_command();
  */
 Command mk_jobs_command();
 
+/**
+ * @brief Create a @a HashCommand structure and return a copy
+ *
+ * @param args A NULL terminated array of strings containing the arguments
+ * passed to hash
+ *
+ * @return Copy of constructed HashCommand as a @a Command
+ *
+ * @sa Command, HashCommand
+ */
+Command mk_hash_command(char** args);
+
+/**
+ * @brief Create a @a JobControlCommand structure and return a copy
+ *
+ * @param type One of @a FG, @a BG or @a WAIT
+ *
+ * @param args A NULL terminated array of strings containing the arguments
+ * passed to the command
+ *
+ * @return Copy of constructed JobControlCommand as a @a Command
+ *
+ * @sa Command, JobControlCommand
+ */
+Command mk_job_control_command(CommandType type, char** args);
+
 /**
  * @brief Create a @a ExitCommand structure and return a copy
  *
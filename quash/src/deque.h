@@ -11,6 +11,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * @def IMPLEMENT_DEQUE_STRUCT(struct_name, type)
@@ -340,6 +341,320 @@
     deq->data[idx] = element;                                           \
   }
 
+/**
+ * @def IMPLEMENT_RING_DEQUE_STRUCT(struct_name, type, inline_cap)
+ *
+ * @brief Generates a structure for a Double Ended Queue that keeps up to @a
+ * inline_cap elements inside the structure itself and only moves them to the
+ * heap once it outgrows them.
+ *
+ * Capacities are always powers of two so elements are found by masking rather
+ * than modulo arithmetic. The structure has the same set of functions as the
+ * one generated by @a IMPLEMENT_DEQUE_STRUCT(), so @a PROTOTYPE_DEQUE() works
+ * for both. Follow this call with @a IMPLEMENT_RING_DEQUE() to generate them.
+ *
+ * @note Copying the structure copies any inline elements along with it, so the
+ * copy is safe to store in another deque while it is still inline.
+ *
+ * @param struct_name The name of the structure
+ *
+ * @param type The name of the type of elements stored in the @a struct_name
+ * structure
+ *
+ * @param inline_cap The number of elements kept inside the structure. This
+ * must be zero or a power of two.
+ *
+ * @sa PROTOTYPE_DEQUE, IMPLEMENT_RING_DEQUE
+*/
+#define IMPLEMENT_RING_DEQUE_STRUCT(struct_name, type, inline_cap)      \
+  typedef struct struct_name {                                          \
+    type* data;    /* Heap buffer, NULL while elements fit inline */    \
+    size_t cap;    /* Power of two, zero once destroyed */              \
+    size_t front;  /* Free running, masked by cap - 1 on access */      \
+    size_t back;                                                        \
+    type inline_data[inline_cap];                                       \
+                                                                        \
+    void (*destructor)(type);                                           \
+  } struct_name;                                                        \
+                                                                        \
+  _Static_assert(((inline_cap) & ((inline_cap) - 1)) == 0,              \
+                 #struct_name " inline capacity must be a power of two");
+
+/**
+ * @def IMPLEMENT_RING_DEQUE(struct_name, type)
+ *
+ * @brief Generates a @a malloc based set of functions for use with a structure
+ * generated by @a IMPLEMENT_RING_DEQUE_STRUCT()
+ *
+ * Growing past the inline storage copies the elements to the heap once. After
+ * that the buffer grows with @a realloc, and only the part of the ring that
+ * had wrapped around to the start of the buffer is moved.
+ *
+ * @param struct_name The name of the structure
+ *
+ * @param type The name of the type of elements stored in the @a struct_name
+ * structure
+ *
+ * @sa IMPLEMENT_RING_DEQUE_STRUCT(), PROTOTYPE_DEQUE()
+ */
+#define IMPLEMENT_RING_DEQUE(struct_name, type)                         \
+                                                                        \
+  void apply_##struct_name(struct_name*, void (*)(type));               \
+                                                                        \
+  static inline type* __buffer_##struct_name(struct_name* deq) {        \
+    return deq->data != NULL ? deq->data : deq->inline_data;            \
+  }                                                                     \
+                                                                        \
+  static inline size_t __inline_cap_##struct_name(struct_name* deq) {   \
+    return sizeof(deq->inline_data) / sizeof(type);                     \
+  }                                                                     \
+                                                                        \
+  static void* __ring_alloc_##struct_name(void* old, size_t cap) {      \
+    void* ret = realloc(old, cap * sizeof(type));                       \
+                                                                        \
+    if (ret == NULL) {                                                  \
+      fprintf(stderr, "ERROR: Failed to allocate struct_name"           \
+              " contents\n");                                           \
+      abort();                                                          \
+    }                                                                   \
+                                                                        \
+    return ret;                                                         \
+  }                                                                     \
+                                                                        \
+  struct_name new_##struct_name(size_t init_cap) {                      \
+    struct_name ret;                                                    \
+    size_t cap = 1;                                                     \
+                                                                        \
+    while (cap < init_cap)                                              \
+      cap <<= 1;                                                        \
+                                                                        \
+    if (cap <= __inline_cap_##struct_name(&ret)) {                      \
+      ret.data = NULL;                                                  \
+      ret.cap = __inline_cap_##struct_name(&ret);                       \
+    }                                                                   \
+    else {                                                              \
+      ret.data = (type*) __ring_alloc_##struct_name(NULL, cap);         \
+      ret.cap = cap;                                                    \
+    }                                                                   \
+                                                                        \
+    ret.front = ret.back = 0;                                           \
+    ret.destructor = NULL;                                              \
+                                                                        \
+    return ret;                                                         \
+  }                                                                     \
+                                                                        \
+  struct_name new_destructable_##struct_name(size_t init_cap,           \
+                                             void (*destructor)(type)){ \
+    struct_name ret = new_##struct_name(init_cap);                      \
+    ret.destructor = destructor;                                        \
+    return ret;                                                         \
+  }                                                                     \
+                                                                        \
+  void destroy_##struct_name(struct_name* deq) {                        \
+    assert(deq != NULL);                                                \
+                                                                        \
+    if (deq->cap == 0)                                                  \
+      return;                                                           \
+                                                                        \
+    if (deq->destructor != NULL)                                        \
+      apply_##struct_name(deq, deq->destructor);                        \
+                                                                        \
+    free(deq->data);                                                    \
+                                                                        \
+    deq->data = NULL;                                                   \
+    deq->cap = deq->front = deq->back = 0;                              \
+  }                                                                     \
+                                                                        \
+  void empty_##struct_name(struct_name* deq) {                          \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+                                                                        \
+    if (deq->destructor != NULL)                                        \
+      apply_##struct_name(deq, deq->destructor);                        \
+                                                                        \
+    deq->front = deq->back = 0;                                         \
+  }                                                                     \
+                                                                        \
+  bool is_empty_##struct_name(struct_name* deq) {                       \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    return deq->front == deq->back;                                     \
+  }                                                                     \
+                                                                        \
+  size_t length_##struct_name(struct_name* deq) {                       \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    return deq->back - deq->front;                                      \
+  }                                                                     \
+                                                                        \
+  type* as_array_##struct_name(struct_name* deq, size_t* len) {         \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+                                                                        \
+    size_t n = length_##struct_name(deq);                               \
+    size_t mask = deq->cap - 1;                                         \
+    type* buf = __buffer_##struct_name(deq);                            \
+    type* ret = (type*) __ring_alloc_##struct_name(NULL, n + 1);        \
+                                                                        \
+    for (size_t i = 0; i < n; ++i)                                      \
+      ret[i] = buf[(deq->front + i) & mask];                            \
+                                                                        \
+    if (len != NULL)                                                    \
+      *len = n;                                                         \
+                                                                        \
+    free(deq->data);                                                    \
+                                                                        \
+    deq->data = NULL;                                                   \
+    deq->cap = deq->front = deq->back = 0;                              \
+                                                                        \
+    return ret;                                                         \
+  }                                                                     \
+                                                                        \
+  void apply_##struct_name(struct_name* deq, void (*func)(type)) {      \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+                                                                        \
+    size_t mask = deq->cap - 1;                                         \
+    type* buf = __buffer_##struct_name(deq);                            \
+                                                                        \
+    for (size_t i = deq->front; i != deq->back; ++i)                    \
+      func(buf[i & mask]);                                              \
+  }                                                                     \
+                                                                        \
+  static void __on_push_##struct_name(struct_name* deq) {               \
+    size_t len = deq->back - deq->front;                                \
+                                                                        \
+    if (len < deq->cap)                                                 \
+      return;                                                           \
+                                                                        \
+    size_t old_cap = deq->cap;                                          \
+    size_t first = deq->front & (old_cap - 1);                          \
+                                                                        \
+    if (deq->data == NULL) {                                            \
+      /* Leave the inline storage, unwrapping the ring on the way */    \
+      type* data = (type*) __ring_alloc_##struct_name(NULL,             \
+                                                      2 * old_cap);     \
+                                                                        \
+      for (size_t i = 0; i < len; ++i)                                  \
+        data[i] = deq->inline_data[(first + i) & (old_cap - 1)];        \
+                                                                        \
+      deq->data = data;                                                 \
+      first = 0;                                                        \
+    }                                                                   \
+    else {                                                              \
+      deq->data = (type*) __ring_alloc_##struct_name(deq->data,         \
+                                                     2 * old_cap);      \
+                                                                        \
+      /* Elements that had wrapped to the start of the old buffer       \
+       * now belong just past its end */                                \
+      memcpy(deq->data + old_cap, deq->data, first * sizeof(type));     \
+    }                                                                   \
+                                                                        \
+    deq->cap = 2 * old_cap;                                             \
+    deq->front = first;                                                 \
+    deq->back = first + len;                                            \
+  }                                                                     \
+                                                                        \
+  static void __on_pop_##struct_name(struct_name* deq) {                \
+    if (is_empty_##struct_name(deq)) {                                  \
+      fprintf(stderr, "ERROR: Cannot pop from of struct_name while it " \
+              "is empty\n");                                            \
+      abort();                                                          \
+    }                                                                   \
+  }                                                                     \
+                                                                        \
+  void push_front_##struct_name(struct_name* deq, type element) {       \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    __on_push_##struct_name(deq);                                       \
+    --deq->front;                                                       \
+    __buffer_##struct_name(deq)[deq->front & (deq->cap - 1)] = element; \
+  }                                                                     \
+                                                                        \
+  void push_back_##struct_name(struct_name* deq, type element) {        \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    __on_push_##struct_name(deq);                                       \
+    __buffer_##struct_name(deq)[deq->back & (deq->cap - 1)] = element;  \
+    ++deq->back;                                                        \
+  }                                                                     \
+                                                                        \
+  type pop_front_##struct_name(struct_name* deq) {                      \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    __on_pop_##struct_name(deq);                                        \
+    size_t old_front = deq->front++;                                    \
+    return __buffer_##struct_name(deq)[old_front & (deq->cap - 1)];     \
+  }                                                                     \
+                                                                        \
+  type pop_back_##struct_name(struct_name* deq) {                       \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    __on_pop_##struct_name(deq);                                        \
+    --deq->back;                                                        \
+    return __buffer_##struct_name(deq)[deq->back & (deq->cap - 1)];     \
+  }                                                                     \
+                                                                        \
+  type peek_front_##struct_name(struct_name* deq) {                     \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    assert(!is_empty_##struct_name(deq));                               \
+    return __buffer_##struct_name(deq)[deq->front & (deq->cap - 1)];    \
+  }                                                                     \
+                                                                        \
+  type peek_back_##struct_name(struct_name* deq) {                      \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    assert(!is_empty_##struct_name(deq));                               \
+    return __buffer_##struct_name(deq)[(deq->back - 1) &                \
+                                       (deq->cap - 1)];                 \
+  }                                                                     \
+                                                                        \
+  void update_front_##struct_name(struct_name* deq, type element) {     \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    assert(!is_empty_##struct_name(deq));                               \
+    __buffer_##struct_name(deq)[deq->front & (deq->cap - 1)] = element; \
+  }                                                                     \
+                                                                        \
+  void update_back_##struct_name(struct_name* deq, type element) {      \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    assert(!is_empty_##struct_name(deq));                               \
+    __buffer_##struct_name(deq)[(deq->back - 1) & (deq->cap - 1)] =     \
+      element;                                                          \
+  }                                                                     \
+                                                                        \
+  void update_and_destroy_front_##struct_name(struct_name* deq,         \
+                                              type element) {           \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    assert(!is_empty_##struct_name(deq));                               \
+                                                                        \
+    type* slot = &__buffer_##struct_name(deq)[deq->front &              \
+                                              (deq->cap - 1)];          \
+                                                                        \
+    if (deq->destructor != NULL)                                        \
+      deq->destructor(*slot);                                           \
+                                                                        \
+    *slot = element;                                                    \
+  }                                                                     \
+                                                                        \
+  void update_and_destroy_back_##struct_name(struct_name* deq,          \
+                                             type element) {            \
+    assert(deq != NULL);                                                \
+    assert(deq->cap != 0); /* Make sure the structure is valid */       \
+    assert(!is_empty_##struct_name(deq));                               \
+                                                                        \
+    type* slot = &__buffer_##struct_name(deq)[(deq->back - 1) &         \
+                                              (deq->cap - 1)];          \
+                                                                        \
+    if (deq->destructor != NULL)                                        \
+      deq->destructor(*slot);                                           \
+                                                                        \
+    *slot = element;                                                    \
+  }
+
 // The following deque is for example and documentation purposes only
 
 /** @brief An example type used for example purposes only */
@@ -0,0 +1,125 @@
+/**
+ * @file deque_test.c
+ *
+ * @brief Checks the ring deques against a plain array model
+ *
+ * Random pushes and pops at both ends are applied to a deque and to the model,
+ * with phases that grow the deque and phases that drain it so the ring wraps
+ * around in both directions and grows from the inline storage to the heap.
+ * Every pop and peek is compared, and each round ends by comparing @a
+ * as_array() with the model.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "deque.h"
+
+IMPLEMENT_RING_DEQUE_STRUCT(HeapRing, int, 0);
+IMPLEMENT_RING_DEQUE(HeapRing, int);
+
+IMPLEMENT_RING_DEQUE_STRUCT(InlineRing, int, 4);
+IMPLEMENT_RING_DEQUE(InlineRing, int);
+
+#define ROUNDS 200
+#define MAX_OPS 400
+
+// Model: the elements are model[lo..hi), with room to grow either way
+#define MODEL_SIZE (4 * MAX_OPS)
+
+static int failures = 0;
+
+// A small fixed generator so every run checks the same sequences
+static unsigned int rng_state;
+
+static unsigned int rng() {
+  rng_state = rng_state * 1103515245u + 12345u;
+  return (rng_state >> 16) & 0x7fff;
+}
+
+static void check(bool ok, const char* what, const char* deque, int round) {
+  if (!ok) {
+    fprintf(stderr, "%s round %d: %s\n", deque, round, what);
+    failures++;
+  }
+}
+
+/**
+ * @def DEQUE_TEST(struct_name)
+ *
+ * @brief Generates test_##struct_name(), which runs the model comparison on a
+ * deque generated by @a IMPLEMENT_RING_DEQUE()
+ */
+#define DEQUE_TEST(struct_name)                                         \
+  static void test_##struct_name() {                                    \
+    int model[MODEL_SIZE];                                              \
+                                                                        \
+    for (int round = 0; round < ROUNDS; ++round) {                      \
+      struct_name deq = new_##struct_name(round % 6);                   \
+      size_t lo = MODEL_SIZE / 2;                                       \
+      size_t hi = lo;                                                   \
+      int ops = rng() % MAX_OPS;                                        \
+                                                                        \
+      for (int op = 0; op < ops; ++op) {                                \
+        /* Alternate between growing and draining every 32 ops */      \
+        bool grow = (op / 32) % 2 == 0;                                 \
+        unsigned int r = rng() % 4;                                     \
+        int value = rng();                                              \
+                                                                        \
+        if (hi == lo || (grow ? r != 0 : r == 0)) {                     \
+          if (rng() % 2) {                                              \
+            push_front_##struct_name(&deq, value);                      \
+            model[--lo] = value;                                        \
+          }                                                             \
+          else {                                                        \
+            push_back_##struct_name(&deq, value);                       \
+            model[hi++] = value;                                        \
+          }                                                             \
+        }                                                               \
+        else if (rng() % 2) {                                           \
+          check(pop_front_##struct_name(&deq) == model[lo++],           \
+                "pop_front", #struct_name, round);                      \
+        }                                                               \
+        else {                                                          \
+          check(pop_back_##struct_name(&deq) == model[--hi],            \
+                "pop_back", #struct_name, round);                       \
+        }                                                               \
+                                                                        \
+        check(length_##struct_name(&deq) == hi - lo, "length",          \
+              #struct_name, round);                                     \
+        if (hi > lo) {                                                  \
+          check(peek_front_##struct_name(&deq) == model[lo],            \
+                "peek_front", #struct_name, round);                     \
+          check(peek_back_##struct_name(&deq) == model[hi - 1],         \
+                "peek_back", #struct_name, round);                      \
+        }                                                               \
+      }                                                                 \
+                                                                        \
+      size_t len;                                                       \
+      int* array = as_array_##struct_name(&deq, &len);                  \
+                                                                        \
+      check(len == hi - lo, "as_array length", #struct_name, round);    \
+      for (size_t i = 0; i < len && i < hi - lo; ++i)                   \
+        if (array[i] != model[lo + i]) {                                \
+          check(false, "as_array element", #struct_name, round);        \
+          break;                                                        \
+        }                                                               \
+                                                                        \
+      free(array);                                                      \
+    }                                                                   \
+  }
+
+DEQUE_TEST(HeapRing)
+DEQUE_TEST(InlineRing)
+
+int main() {
+  rng_state = 241;
+
+  test_HeapRing();
+  test_InlineRing();
+
+  printf("Ring deque rounds checked against the model: %d, failures: %d "
+         "(expected 0).\n", 2 * ROUNDS, failures);
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
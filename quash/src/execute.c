@@ -11,8 +11,20 @@
 
 #include "execute.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/wait.h>
+#include <time.h>
 
 #include "quash.h"
 #include "deque.h"
@@ -20,26 +32,95 @@
 #define READ 0
 #define WRITE 1
 
-IMPLEMENT_DEQUE_STRUCT(PID_QUEUE, pid_t);
-IMPLEMENT_DEQUE(PID_QUEUE, pid_t);
+/* Most capacity asked for a pipe fed from a large file, and the splice() chunk.
+ * Grown pipes count against the per-user fs.pipe-user-pages-soft limit. */
+#define PIPE_BUFFER_SIZE (1 << 20)
 
-/* Job structure to hold jobs in queue */
+/* Capacity the kernel gives a new pipe */
+#define PIPE_DEFAULT_SIZE (1 << 16)
+
+/* Environment variable naming the file job accounting is appended to */
+#define ACCT_LOG_VAR "QUASH_ACCT"
+
+IMPLEMENT_RING_DEQUE_STRUCT(PID_QUEUE, pid_t, 4);
+IMPLEMENT_RING_DEQUE(PID_QUEUE, pid_t);
+
+/* Resources used by one process of an accounted job */
+typedef struct ProcessUsage
+{
+	pid_t pid;       // 0 until the process has started
+	char *name;      // program or builtin run by the process
+	bool done;       // reaped, so the fields below are filled in
+	double real;     // seconds from the start of the job until it was reaped
+	struct rusage ru;
+} ProcessUsage;
+
+/* Job structure to hold jobs in the job table */
 typedef struct Job
 {
 	int job_id;
+	pid_t pgid; // process group of the job, 0 while it shares quash's
 	PID_QUEUE pid_queue;
+	size_t running; // processes not reaped yet
+	bool stopped;
+	bool timed; // prefixed with time
+	struct timespec started;
+	ProcessUsage *usage; // one per pipeline stage, NULL unless accounted
+	size_t stages;
 	char *cmd;
 } Job;
-IMPLEMENT_DEQUE_STRUCT(JOB_QUEUE, struct Job);
-IMPLEMENT_DEQUE(JOB_QUEUE, struct Job);
-JOB_QUEUE job_queue_pointer;
 
-/* Pipe tracker */
-static int environment_pipes[2][2];
-static int prev_pipe = -1;
-static int next_pipe = 0;
+/* Background jobs indexed by job id. Slot 0 is unused and a slot is free
+ * while its cmd is NULL */
+static Job *job_table = NULL;
+static int job_table_cap = 0;
+static int last_job = 0; // highest job id in use
 
-static bool init_flag = true;
+/* Maps the pid of every unreaped background process to its job id */
+typedef struct PidSlot
+{
+	pid_t pid; // 0 marks an empty slot
+	int job_id;
+} PidSlot;
+static PidSlot *pid_map = NULL;
+static size_t pid_map_cap = 0; // always a power of two
+static size_t pid_map_used = 0;
+
+/* Jobs whose processes have all been reaped, waiting to be reported */
+IMPLEMENT_RING_DEQUE_STRUCT(JOB_IDS, int, 8);
+IMPLEMENT_RING_DEQUE(JOB_IDS, int);
+static JOB_IDS completed_jobs = { NULL, 8, 0, 0, { 0 }, NULL };
+
+/* Absolute paths of commands found through PATH, keyed by command name */
+typedef struct PathSlot
+{
+	char *name; // NULL marks an empty slot
+	char *path; // NULL once the cached path stopped working
+	int hits;   // times the command was run through this entry
+} PathSlot;
+static PathSlot *path_cache = NULL;
+static size_t path_cache_cap = 0; // always a power of two
+static size_t path_cache_used = 0;
+
+/* Accounting log, kept open while ACCT_LOG_VAR names the same file */
+static FILE *acct_log = NULL;
+static char *acct_log_path = NULL;
+
+/* Job control, set up by init_job_control() for interactive use */
+static bool job_control = false;
+static pid_t shell_pgid = 0;
+static const int job_control_signals[] = { SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU };
+#define NUM_JOB_CONTROL_SIGNALS (sizeof(job_control_signals) / sizeof(job_control_signals[0]))
+
+/* signalfd for SIGCHLD, created by job_event_fd() */
+static int job_events = -1;
+static sigset_t child_sigmask; // signal mask children start with
+
+/* Pipes of the pipeline being started, pipeline[i] connecting stage i to
+ * stage i + 1 */
+static int (*pipeline)[2] = NULL;
+static size_t pipeline_cap = 0;
+static size_t pipeline_len = 0;
 
 /***************************************************************************
  * Interface Functions
@@ -65,34 +146,701 @@ const char *lookup_env(const char *env_var)
 	return getenv(env_var);
 }
 
-// Check the status of background jobs
-void check_jobs_bg_status()
+// Returns the value of the environment variable named by the len characters at
+// env_var
+const char *lookup_env_n(const char *env_var, size_t len)
+{
+	for (char **env = environ; *env != NULL; env++)
+		if (strncmp(*env, env_var, len) == 0 && (*env)[len] == '=')
+			return *env + len + 1;
+
+	return NULL;
+}
+
+/***************************************************************************
+ * Command path cache
+ ***************************************************************************/
+
+static size_t path_cache_slot(const char *name)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (; *name != '\0'; name++)
+		hash = (hash ^ (unsigned char)*name) * 16777619u;
+
+	return hash & (path_cache_cap - 1);
+}
+
+// Returns the slot holding name, or the empty slot it would go in
+static PathSlot *path_cache_find(const char *name)
+{
+	size_t i = path_cache_slot(name);
+	while (path_cache[i].name != NULL && strcmp(path_cache[i].name, name) != 0)
+		i = (i + 1) & (path_cache_cap - 1);
+
+	return &path_cache[i];
+}
+
+// Doubles the path cache, rehashing every entry
+static void path_cache_grow()
+{
+	PathSlot *old = path_cache;
+	size_t old_cap = path_cache_cap;
+
+	path_cache_cap = old_cap ? 2 * old_cap : 64;
+	path_cache = calloc(path_cache_cap, sizeof(PathSlot));
+	if (path_cache == NULL)
+	{
+		perror("ERROR: Failed to grow the command path cache");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t i = 0; i < old_cap; i++)
+		if (old[i].name != NULL)
+			*path_cache_find(old[i].name) = old[i];
+
+	free(old);
+}
+
+// Empties the path cache
+static void path_cache_clear()
+{
+	for (size_t i = 0; i < path_cache_cap; i++)
+	{
+		free(path_cache[i].name);
+		free(path_cache[i].path);
+	}
+
+	free(path_cache);
+	path_cache = NULL;
+	path_cache_cap = 0;
+	path_cache_used = 0;
+}
+
+// Walks PATH for an executable called name. Returns a malloced absolute path,
+// or NULL if there is none or a relative directory comes first, since a path
+// found through one would change with the working directory.
+static char *search_path(const char *name)
+{
+	const char *dirs = lookup_env("PATH");
+	if (dirs == NULL)
+		return NULL;
+
+	char file[PATH_MAX];
+	while (true)
+	{
+		const char *end = strchrnul(dirs, ':');
+		int dir_len = end - dirs;
+
+		if (dir_len == 0 || dirs[0] != '/')
+			return NULL;
+
+		struct stat st;
+		if (snprintf(file, sizeof(file), "%.*s/%s", dir_len, dirs, name) < (int)sizeof(file) &&
+				stat(file, &st) == 0 && S_ISREG(st.st_mode) && access(file, X_OK) == 0)
+			return strdup(file);
+
+		if (*end == '\0')
+			return NULL;
+		dirs = end + 1;
+	}
+}
+
+// Returns the cached absolute path of the command name, searching PATH on the
+// first use. Returns NULL when PATH cannot resolve it to an absolute path, in
+// which case the caller falls back to the exec functions' own PATH search.
+static const char *resolve_command(const char *name, bool run)
+{
+	if (strchr(name, '/') != NULL)
+		return NULL;
+
+	if (4 * (path_cache_used + 1) > 3 * path_cache_cap)
+		path_cache_grow();
+
+	PathSlot *slot = path_cache_find(name);
+	if (slot->name == NULL || slot->path == NULL)
+	{
+		char *path = search_path(name);
+		if (path == NULL)
+			return NULL;
+
+		if (slot->name == NULL)
+		{
+			slot->name = strdup(name);
+			path_cache_used++;
+		}
+		slot->path = path;
+		slot->hits = 0;
+	}
+
+	if (run)
+		slot->hits++;
+
+	return slot->path;
+}
+
+// Drops the cached path of name so the next use searches PATH again
+static void forget_command(const char *name)
+{
+	if (path_cache_used == 0)
+		return;
+
+	PathSlot *slot = path_cache_find(name);
+	if (slot->name != NULL)
+	{
+		free(slot->path);
+		slot->path = NULL;
+	}
+}
+
+/***************************************************************************
+ * Job table
+ ***************************************************************************/
+
+static size_t pid_map_slot(pid_t pid)
+{
+	return ((uint32_t)pid * 2654435761u) & (pid_map_cap - 1);
+}
+
+static void pid_map_put(pid_t pid, int job_id);
+
+// Doubles the pid map, rehashing every entry
+static void pid_map_grow()
+{
+	PidSlot *old = pid_map;
+	size_t old_cap = pid_map_cap;
+
+	pid_map_cap = old_cap ? 2 * old_cap : 64;
+	pid_map = calloc(pid_map_cap, sizeof(PidSlot));
+	if (pid_map == NULL)
+	{
+		perror("ERROR: Failed to grow the pid map");
+		exit(EXIT_FAILURE);
+	}
+
+	pid_map_used = 0;
+	for (size_t i = 0; i < old_cap; i++)
+		if (old[i].pid != 0)
+			pid_map_put(old[i].pid, old[i].job_id);
+
+	free(old);
+}
+
+static void pid_map_put(pid_t pid, int job_id)
+{
+	if (4 * (pid_map_used + 1) > 3 * pid_map_cap)
+		pid_map_grow();
+
+	size_t i = pid_map_slot(pid);
+	while (pid_map[i].pid != 0)
+		i = (i + 1) & (pid_map_cap - 1);
+
+	pid_map[i].pid = pid;
+	pid_map[i].job_id = job_id;
+	pid_map_used++;
+}
+
+// Removes pid from the map and returns its job id, or 0 if it was not there
+static int pid_map_take(pid_t pid)
+{
+	if (pid_map_used == 0)
+		return 0;
+
+	size_t mask = pid_map_cap - 1;
+	size_t i = pid_map_slot(pid);
+	while (pid_map[i].pid != pid)
+	{
+		if (pid_map[i].pid == 0)
+			return 0;
+		i = (i + 1) & mask;
+	}
+
+	int job_id = pid_map[i].job_id;
+	pid_map_used--;
+
+	// Shift later entries of the probe run back so no lookup stops early
+	size_t j = i;
+	while (true)
+	{
+		j = (j + 1) & mask;
+		if (pid_map[j].pid == 0)
+			break;
+
+		size_t home = pid_map_slot(pid_map[j].pid);
+		// Leave entries whose home lies cyclically in (i, j]
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+
+		pid_map[i] = pid_map[j];
+		i = j;
+	}
+	pid_map[i].pid = 0;
+
+	return job_id;
+}
+
+static Job *find_job(int job_id)
+{
+	if (job_id <= 0 || job_id > last_job || job_table[job_id].cmd == NULL)
+		return NULL;
+	return &job_table[job_id];
+}
+
+// Adds a background job under the next job id and indexes its processes
+static Job *add_job(Job job)
+{
+	assert(job.job_id == last_job + 1);
+
+	if (job.job_id >= job_table_cap)
+	{
+		int cap = job_table_cap ? 2 * job_table_cap : 16;
+		Job *table = realloc(job_table, cap * sizeof(Job));
+		if (table == NULL)
+		{
+			perror("ERROR: Failed to grow the job table");
+			exit(EXIT_FAILURE);
+		}
+		for (int i = job_table_cap; i < cap; i++)
+			table[i].cmd = NULL;
+
+		job_table = table;
+		job_table_cap = cap;
+	}
+
+	job.running = length_PID_QUEUE(&job.pid_queue);
+	for (size_t i = 0; i < job.running; i++)
+	{
+		pid_t pid = pop_front_PID_QUEUE(&job.pid_queue);
+		pid_map_put(pid, job.job_id);
+		push_back_PID_QUEUE(&job.pid_queue, pid);
+	}
+
+	job_table[job.job_id] = job;
+	last_job = job.job_id;
+
+	return &job_table[job.job_id];
+}
+
+static void free_job_usage(Job *job)
+{
+	if (job->usage == NULL)
+		return;
+
+	for (size_t i = 0; i < job->stages; i++)
+		free(job->usage[i].name);
+	free(job->usage);
+	job->usage = NULL;
+}
+
+static void remove_job(Job *job)
+{
+	free_job_usage(job);
+	free(job->cmd);
+	job->cmd = NULL;
+	destroy_PID_QUEUE(&job->pid_queue);
+
+	while (last_job > 0 && job_table[last_job].cmd == NULL)
+		last_job--;
+}
+
+/***************************************************************************
+ * Job accounting
+ ***************************************************************************/
+
+static double seconds_since(struct timespec start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static double timeval_seconds(struct timeval tv)
+{
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Name a pipeline stage is logged under
+static const char *stage_name(CommandHolder holder)
+{
+	switch (get_command_holder_type(holder))
+	{
+		case GENERIC: return holder.cmd.generic.args[0];
+		case ECHO:    return "echo";
+		case EXPORT:  return "export";
+		case CD:      return "cd";
+		case PWD:     return "pwd";
+		case JOBS:    return "jobs";
+		case KILL:    return "kill";
+		case HASH:    return "hash";
+		case FG:      return "fg";
+		case BG:      return "bg";
+		case WAIT:    return "wait";
+		default:      return "quash";
+	}
+}
+
+// Sets up the accounting of a job about to start if it is timed or the
+// accounting log is on. Otherwise the job's usage stays NULL and costs
+// nothing.
+static void job_usage_start(Job *job, CommandHolder *holders, size_t stages)
+{
+	job->timed = false;
+	job->usage = NULL;
+	job->stages = stages;
+
+	for (size_t i = 0; i < stages; i++)
+		job->timed |= (holders[i].flags & TIMED) != 0;
+
+	if (!job->timed && lookup_env(ACCT_LOG_VAR) == NULL)
+		return;
+
+	job->usage = calloc(stages, sizeof(ProcessUsage));
+	for (size_t i = 0; i < stages; i++)
+		job->usage[i].name = strdup(stage_name(holders[i]));
+
+	clock_gettime(CLOCK_MONOTONIC, &job->started);
+}
+
+// Records the resources a reaped process of the job used
+static void job_usage_reaped(Job *job, pid_t pid, const struct rusage *ru)
+{
+	if (job->usage == NULL)
+		return;
+
+	for (size_t i = 0; i < job->stages; i++)
+	{
+		if (job->usage[i].pid == pid)
+		{
+			job->usage[i].done = true;
+			job->usage[i].real = seconds_since(job->started);
+			job->usage[i].ru = *ru;
+			return;
+		}
+	}
+}
+
+// Records the resources quash used running a builtin itself since `before`
+static void job_usage_in_process(Job *job, const struct rusage *before)
+{
+	if (job->usage == NULL)
+		return;
+
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+
+	timersub(&ru.ru_utime, &before->ru_utime, &ru.ru_utime);
+	timersub(&ru.ru_stime, &before->ru_stime, &ru.ru_stime);
+	ru.ru_nvcsw -= before->ru_nvcsw;
+	ru.ru_nivcsw -= before->ru_nivcsw;
+
+	// ru_maxrss is the peak of quash's whole lifetime, not of the builtin, and
+	// has no delta, so builtins report none
+	ru.ru_maxrss = 0;
+
+	job->usage[0].pid = getpid();
+	job_usage_reaped(job, job->usage[0].pid, &ru);
+}
+
+// Returns the accounting log to append to, or NULL if it is off. The file is
+// reopened whenever ACCT_LOG_VAR changes.
+static FILE *acct_log_file()
+{
+	const char *path = lookup_env(ACCT_LOG_VAR);
+
+	if (acct_log != NULL && (path == NULL || strcmp(path, acct_log_path) != 0))
+	{
+		fclose(acct_log);
+		free(acct_log_path);
+		acct_log = NULL;
+		acct_log_path = NULL;
+	}
+
+	if (acct_log == NULL && path != NULL && path[0] != '\0')
+	{
+		acct_log = fopen(path, "a");
+		if (acct_log == NULL)
+			fprintf(stderr, "ERROR: Failed to open accounting log %s: %s\n", path, strerror(errno));
+		else
+			acct_log_path = strdup(path);
+	}
+
+	return acct_log;
+}
+
+static void print_time(const char *label, double seconds)
+{
+	int minutes = (int) (seconds / 60);
+	fprintf(stderr, "%s\t%dm%.3fs\n", label, minutes, seconds - 60 * minutes);
+}
+
+/**
+ * @brief Reports the resources a job used once all of its processes are
+ * reaped, then frees its accounting
+ *
+ * A timed job prints its totals to stderr. With the accounting log on, a line
+ * for every process followed by one for the whole job is appended to it.
+ * Times add up over the processes, while the maximum resident set size is the
+ * largest of any one process.
+ *
+ * @param job The job, with its accounting set up by @a job_usage_start()
+ *
+ * @param cmd The command string of the job, or NULL for the one being run
+ */
+static void finish_job_usage(Job *job, const char *cmd)
+{
+	if (job->usage == NULL)
+		return;
+
+	double real = seconds_since(job->started);
+	size_t done = 0;
+	struct timeval utime = { 0, 0 };
+	struct timeval stime = { 0, 0 };
+	long maxrss = 0;
+	long nvcsw = 0;
+	long nivcsw = 0;
+
+	for (size_t i = 0; i < job->stages; i++)
+	{
+		ProcessUsage *u = &job->usage[i];
+		if (!u->done)
+			continue;
+
+		done++;
+		timeradd(&utime, &u->ru.ru_utime, &utime);
+		timeradd(&stime, &u->ru.ru_stime, &stime);
+		if (u->ru.ru_maxrss > maxrss)
+			maxrss = u->ru.ru_maxrss;
+		nvcsw += u->ru.ru_nvcsw;
+		nivcsw += u->ru.ru_nivcsw;
+	}
+
+	if (job->timed)
+	{
+		fprintf(stderr, "\n");
+		print_time("real", real);
+		print_time("user", timeval_seconds(utime));
+		print_time("sys", timeval_seconds(stime));
+		fprintf(stderr, "maxrss\t%ld kB\n", maxrss);
+		fprintf(stderr, "ctxsw\t%ld voluntary, %ld involuntary\n", nvcsw, nivcsw);
+	}
+
+	// A job that ran nothing, such as a command that could not be started,
+	// is left out of the log
+	FILE *log = done > 0 ? acct_log_file() : NULL;
+	if (log != NULL)
+	{
+		char *owned = NULL;
+		if (cmd == NULL)
+			cmd = owned = get_command_string();
+
+		for (size_t i = 0; i < job->stages; i++)
+		{
+			ProcessUsage *u = &job->usage[i];
+			if (!u->done)
+				continue;
+
+			fprintf(log, "process\t%d\t%.6f\t%.6f\t%.6f\t%ld\t%ld\t%ld\t%s\n", u->pid, u->real,
+					timeval_seconds(u->ru.ru_utime), timeval_seconds(u->ru.ru_stime),
+					u->ru.ru_maxrss, u->ru.ru_nvcsw, u->ru.ru_nivcsw, u->name);
+		}
+
+		fprintf(log, "job\t%d\t%.6f\t%.6f\t%.6f\t%ld\t%ld\t%ld\t%s\n", job->usage[0].pid, real,
+				timeval_seconds(utime), timeval_seconds(stime), maxrss, nvcsw, nivcsw, cmd);
+		fflush(log);
+
+		free(owned);
+	}
+
+	free_job_usage(job);
+}
+
+// Accounts for a reaped background process, queueing its job for the
+// completion message once the job has no processes left
+static void job_process_reaped(pid_t pid, const struct rusage *ru)
+{
+	Job *job = find_job(pid_map_take(pid));
+	if (job == NULL)
+		return;
+
+	job_usage_reaped(job, pid, ru);
+	if (--job->running == 0)
+		push_back_JOB_IDS(&completed_jobs, job->job_id);
+}
+
+static int compare_job_ids(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+// Finds the job a fg, bg or wait command names, or the most recent job if it
+// names none. Prints an error and returns NULL if there is no such job.
+static Job *job_control_target(JobControlCommand cmd)
+{
+	int job_id = last_job;
+	if (cmd.args[0] != NULL)
+		job_id = atoi(cmd.args[0] + (cmd.args[0][0] == '%'));
+
+	Job *job = find_job(job_id);
+	if (job == NULL)
+		fprintf(stderr, "ERROR: No such job: %d\n", job_id);
+
+	return job;
+}
+
+// Waits on the process group of a job in the foreground until its running
+// processes have exited or the job is stopped. Exited processes leave the pid
+// map and the pid queue of the job. Returns the number of processes still
+// running, which is zero unless the job was stopped.
+static size_t wait_for_job(Job *job, size_t running)
 {
-	// Check on the statuses of all processes belonging to all background
-	// jobs. This function should remove jobs from the jobs queue once all
-	// processes belonging to a job have completed.
-	int length_q = length_JOB_QUEUE (&job_queue_pointer);
-
-	for(int i = 0; i < length_q; i++) {
-		Job temp_job = pop_front_JOB_QUEUE(&job_queue_pointer);
-		int wait;
-		int length_p = length_PID_QUEUE (&temp_job.pid_queue);
-		for(int j = 0; j < length_p; j++) {
-			pid_t temp_pid = pop_front_PID_QUEUE(&temp_job.pid_queue);
-			// still going
-			if(waitpid(temp_pid, &wait, WNOHANG) == 0) {
-				push_back_PID_QUEUE(&temp_job.pid_queue, temp_pid);
+	while (running > 0)
+	{
+		int status;
+		struct rusage ru;
+		pid_t pid = wait4(-job->pgid, &status, job_control ? WUNTRACED : 0, &ru);
+
+		if (pid == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			return 0;
+		}
+
+		if (WIFSTOPPED(status))
+		{
+			// A process that read the terminal before it was handed over is
+			// simply let go on
+			if (WSTOPSIG(status) == SIGTTIN || WSTOPSIG(status) == SIGTTOU)
+			{
+				killpg(job->pgid, SIGCONT);
+				continue;
 			}
+			return running;
+		}
+
+		pid_map_take(pid);
+		job_usage_reaped(job, pid, &ru);
+		running--;
+
+		size_t n = length_PID_QUEUE(&job->pid_queue);
+		for (size_t i = 0; i < n; i++)
+		{
+			pid_t temp_id = pop_front_PID_QUEUE(&job->pid_queue);
+			if (temp_id != pid)
+				push_back_PID_QUEUE(&job->pid_queue, temp_id);
 		}
+	}
+
+	return 0;
+}
+
+// Gives the terminal to a foreground job
+static void give_terminal(pid_t pgid)
+{
+	if (job_control)
+		tcsetpgrp(STDIN_FILENO, pgid);
+}
+
+// Takes the terminal back once the foreground job has exited or stopped
+static void take_terminal()
+{
+	if (job_control)
+		tcsetpgrp(STDIN_FILENO, shell_pgid);
+}
+
+// Puts quash in its own process group in charge of the terminal
+void init_job_control()
+{
+	if (!isatty(STDIN_FILENO))
+		return;
+
+	// Wait to be put in the foreground if started in the background
+	while (tcgetpgrp(STDIN_FILENO) != (shell_pgid = getpgrp()))
+		kill(-shell_pgid, SIGTTIN);
+
+	// Terminal signals are for the foreground job, not quash
+	for (size_t i = 0; i < NUM_JOB_CONTROL_SIGNALS; i++)
+		signal(job_control_signals[i], SIG_IGN);
+
+	// This fails harmlessly if quash already leads its session
+	if (setpgid(0, 0) == 0)
+		shell_pgid = getpid();
+
+	tcsetpgrp(STDIN_FILENO, shell_pgid);
+	job_control = true;
+}
+
+// Returns a file descriptor that polls readable once a child process exits
+int job_event_fd()
+{
+	if (job_events == -1)
+	{
+		sigset_t mask;
+		sigemptyset(&mask);
+		sigaddset(&mask, SIGCHLD);
+
+		// SIGCHLD must be blocked to be read from a signalfd. Children get the
+		// old mask back before they run anything.
+		sigprocmask(SIG_BLOCK, &mask, &child_sigmask);
+		job_events = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
 
-		if (is_empty_PID_QUEUE (&temp_job.pid_queue)) {
-			print_job_bg_complete(temp_job.job_id, 1234, temp_job.cmd);
-			free (temp_job.cmd);
-			destroy_PID_QUEUE (&temp_job.pid_queue);
-		} else {
-			push_back_JOB_QUEUE(&job_queue_pointer, temp_job);
+		if (job_events == -1)
+		{
+			perror("ERROR: Failed to watch for exiting jobs");
+			sigprocmask(SIG_SETMASK, &child_sigmask, NULL);
 		}
 	}
+
+	return job_events;
+}
+
+// Reap background processes that have exited
+size_t reap_jobs_bg()
+{
+	pid_t pid;
+	int status;
+	struct rusage ru;
+
+	// Drain the event fd before reaping so a child exiting after the last
+	// waitpid() wakes the next poll()
+	if (job_events != -1)
+	{
+		struct signalfd_siginfo info;
+		while (read(job_events, &info, sizeof(info)) == sizeof(info))
+			;
+	}
+
+	// Only background processes are still unreaped between commands, so this
+	// costs one syscall per exited process plus one, and none without
+	// background jobs.
+	while (pid_map_used > 0 && (pid = wait4(-1, &status, WNOHANG, &ru)) > 0)
+		job_process_reaped(pid, &ru);
+
+	return length_JOB_IDS(&completed_jobs);
+}
+
+// Check the status of background jobs
+void check_jobs_bg_status()
+{
+	if (reap_jobs_bg() == 0)
+		return;
+
+	// Report completions in job id order
+	size_t n;
+	int *ids = as_array_JOB_IDS(&completed_jobs, &n);
+	completed_jobs = new_JOB_IDS(8);
+	qsort(ids, n, sizeof(int), compare_job_ids);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		Job *job = &job_table[ids[i]];
+		print_job_bg_complete(job->job_id, peek_front_PID_QUEUE(&job->pid_queue), job->cmd);
+		fflush(stdout);
+		finish_job_usage(job, job->cmd);
+		remove_job(job);
+	}
+
+	free(ids);
 }
 
 // Prints the job id number, the process id of the first process belonging to
@@ -110,27 +858,93 @@ void print_job_bg_start(int job_id, pid_t pid, const char *cmd)
 	print_job(job_id, pid, cmd);
 }
 
-// Prints a completion message followed by the print job
-void print_job_bg_complete(int job_id, pid_t pid, const char *cmd)
-{
-	printf("Completed: \t");
-	print_job(job_id, pid, cmd);
+// Prints a completion message followed by the print job
+void print_job_bg_complete(int job_id, pid_t pid, const char *cmd)
+{
+	printf("Completed: \t");
+	print_job(job_id, pid, cmd);
+}
+
+// Prints a stopped message followed by the print job
+void print_job_stopped(int job_id, pid_t pid, const char *cmd)
+{
+	printf("\nStopped: \t");
+	print_job(job_id, pid, cmd);
+}
+
+/***************************************************************************
+ * Functions to process commands
+ ***************************************************************************/
+// Checks for `cat` with no options and at most one file, which splice_cat()
+// can run without the cat program
+static bool is_plain_cat(GenericCommand cmd)
+{
+	char **args = cmd.args;
+
+	return strcmp(args[0], "cat") == 0 &&
+		(args[1] == NULL || (args[1][0] != '-' && args[2] == NULL));
+}
+
+// Copies the file of a plain cat, or stdin, to stdout with splice() so the data
+// never passes through user space. Returns false without having copied
+// anything if neither end is a pipe or the file cannot be opened; the cat
+// program is run instead then.
+static bool splice_cat(GenericCommand cmd)
+{
+	int in = STDIN_FILENO;
+	if (cmd.args[1] != NULL && (in = open(cmd.args[1], O_RDONLY)) == -1)
+		return false;
+
+	bool copied = false;
+	while (true)
+	{
+		ssize_t n = splice(in, NULL, STDOUT_FILENO, NULL, PIPE_BUFFER_SIZE, SPLICE_F_MOVE | SPLICE_F_MORE);
+
+		if (n == 0)
+			break;
+
+		if (n == -1)
+		{
+			if (errno == EINTR)
+				continue;
+
+			if (!copied && errno == EINVAL)
+			{
+				if (in != STDIN_FILENO)
+					close(in);
+				return false;
+			}
+
+			perror("cat");
+			exit(EXIT_FAILURE);
+		}
+
+		copied = true;
+	}
+
+	if (in != STDIN_FILENO)
+		close(in);
+	return true;
 }
 
-/***************************************************************************
- * Functions to process commands
- ***************************************************************************/
 // Run a program reachable by the path environment variable, relative path, or
 // absolute path
 void run_generic(GenericCommand cmd)
 {
+	if (is_plain_cat(cmd) && splice_cat(cmd))
+		return;
+
 	// Execute a program with a list of arguments. The `args` array is a NULL
 	// terminated (last string is always NULL) list of strings. The first element
 	// in the array is the executable
 	char *exec = cmd.args[0];
 	char **args = cmd.args;
 
-	execvp(exec, args);
+	const char *path = resolve_command(exec, true);
+	if (path != NULL)
+		execv(path, args);
+	else
+		execvp(exec, args);
 
 	perror("ERROR: Failed to execute program");
 }
@@ -162,6 +976,10 @@ void run_export(ExportCommand cmd)
 	const char *val = cmd.val;
 
 	setenv(env_var, val, 1);
+
+	// Commands may resolve differently under the new PATH
+	if (strcmp(env_var, "PATH") == 0)
+		path_cache_clear();
 }
 
 // Changes the current working directory
@@ -196,22 +1014,45 @@ void run_kill(KillCommand cmd)
 	int signal = cmd.sig;
 	int job_id = cmd.job;
 
-	Job temp_job;
-	int length_q = length_JOB_QUEUE (&job_queue_pointer);
+	Job *job = find_job(job_id);
+	if (job == NULL)
+	{
+		fprintf(stderr, "ERROR: No such job: %d\n", job_id);
+		return;
+	}
+
+	// Nothing is left of a job whose processes were all reaped, and its process
+	// group id may belong to someone else by now
+	if (job->running == 0)
+		return;
+
+	// The processes of a background job share its process group, so one call
+	// signals all of them
+	killpg(job->pgid, signal);
+
+	if (signal == SIGCONT)
+		job->stopped = false;
+
+	// SIGKILL cannot be caught, so reap the processes now and report the job
+	// as completed before the next command runs
+	if (signal == SIGKILL)
+	{
+		while (job->running > 0)
+		{
+			int status;
+			struct rusage ru;
+			pid_t pid = wait4(-job->pgid, &status, 0, &ru);
 
-	for(int i = 0; i < length_q; i++) {
-		temp_job = pop_front_JOB_QUEUE(&job_queue_pointer);
-		if(temp_job.job_id == job_id) {
-			int length_p = length_PID_QUEUE (&temp_job.pid_queue);
-			for(int j = 0; j < length_p; j++) {
-				pid_t temp_id = pop_front_PID_QUEUE(&temp_job.pid_queue);
-				kill(temp_id, signal);
+			if (pid == -1)
+			{
+				if (errno == EINTR)
+					continue;
+				break;
 			}
+
+			job_process_reaped(pid, &ru);
 		}
-		push_back_JOB_QUEUE(&job_queue_pointer, temp_job);
 	}
-
-	// Kill all processes associated with a background job
 }
 
 // Prints the current working directory to stdout
@@ -228,19 +1069,136 @@ void run_pwd()
 	fflush(stdout);
 }
 
-// Prints all background jobs currently in the job list to stdout
-void run_jobs()
+// Updates the table of resolved command paths
+void run_hash(HashCommand cmd)
 {
-	// Print background jobs
-	if(is_empty_JOB_QUEUE(&job_queue_pointer)) {
+	for (int i = 0; cmd.args[i] != NULL; i++)
+	{
+		if (strcmp(cmd.args[i], "-r") == 0)
+			path_cache_clear();
+		else if (resolve_command(cmd.args[i], false) == NULL && strchr(cmd.args[i], '/') == NULL)
+			fprintf(stderr, "hash: %s: not found\n", cmd.args[i]);
+	}
+}
+
+// Prints the table of resolved command paths to stdout
+void run_hash_list()
+{
+	if (path_cache_used == 0)
+	{
+		printf("hash: hash table empty\n");
+	}
+	else
+	{
+		printf("hits\tcommand\n");
+		for (size_t i = 0; i < path_cache_cap; i++)
+			if (path_cache[i].path != NULL)
+				printf("%4d\t%s\n", path_cache[i].hits, path_cache[i].path);
+	}
+
+	// Flush the buffer before returning
+	fflush(stdout);
+}
+
+// Continues a job in the foreground and waits for it
+void run_fg(JobControlCommand cmd)
+{
+	Job *job = job_control_target(cmd);
+	if (job == NULL)
+		return;
+
+	printf("%s\n", job->cmd);
+	fflush(stdout);
+
+	// A job with nothing left running is reported as completed as usual
+	if (job->running == 0)
+		return;
+
+	give_terminal(job->pgid);
+	killpg(job->pgid, SIGCONT);
+	job->running = wait_for_job(job, job->running);
+	job->stopped = job->running > 0;
+	take_terminal();
+
+	if (job->stopped)
+	{
+		print_job_stopped(job->job_id, peek_front_PID_QUEUE(&job->pid_queue), job->cmd);
+	}
+	else
+	{
+		// Every process was reaped here, so the job is not reported as
+		// completed later
+		fflush(stdout);
+		finish_job_usage(job, job->cmd);
+		remove_job(job);
+	}
+}
+
+// Continues a stopped job in the background
+void run_bg(JobControlCommand cmd)
+{
+	Job *job = job_control_target(cmd);
+	if (job == NULL)
 		return;
+
+	if (job->running > 0)
+		killpg(job->pgid, SIGCONT);
+	job->stopped = false;
+
+	print_job(job->job_id, peek_front_PID_QUEUE(&job->pid_queue), job->cmd);
+}
+
+// Waits for one background job, or all of them, to complete
+void run_wait(JobControlCommand cmd)
+{
+	int first = 1;
+	int last = last_job;
+
+	if (cmd.args[0] != NULL)
+	{
+		Job *job = job_control_target(cmd);
+		if (job == NULL)
+			return;
+		first = last = job->job_id;
+	}
+
+	for (int i = first; i <= last; i++)
+	{
+		Job *job = find_job(i);
+
+		// A stopped job would never complete
+		if (job == NULL || job->stopped)
+			continue;
+
+		while (job->running > 0)
+		{
+			int status;
+			struct rusage ru;
+			pid_t pid = wait4(-job->pgid, &status, 0, &ru);
+
+			if (pid == -1)
+			{
+				if (errno == EINTR)
+					continue;
+				break;
+			}
+
+			job_process_reaped(pid, &ru);
+		}
 	}
 
-	Job temp_job;
-	for(int i = 0; i < length_JOB_QUEUE(&job_queue_pointer); i++) {
-		temp_job = pop_front_JOB_QUEUE(&job_queue_pointer);
-		print_job(temp_job.job_id, 1234, temp_job.cmd);
-		push_back_JOB_QUEUE(&job_queue_pointer, temp_job);
+	check_jobs_bg_status();
+}
+
+// Prints all background jobs currently in the job list to stdout
+void run_jobs()
+{
+	// Print background jobs
+	for (int i = 1; i <= last_job; i++)
+	{
+		Job *job = find_job(i);
+		if (job != NULL)
+			print_job(job->job_id, peek_front_PID_QUEUE(&job->pid_queue), job->cmd);
 	}
 
 	// Flush the buffer before returning
@@ -283,6 +1241,17 @@ void child_run_command(Command cmd)
 		case JOBS:
 			run_jobs();
 			break;
+
+		case HASH:
+			if (cmd.hash.args[0] == NULL)
+				run_hash_list();
+			break;
+		case FG:
+			break;
+		case BG:
+			break;
+		case WAIT:
+			break;
 		case EXPORT:
 			break;
 		case CD:
@@ -327,6 +1296,22 @@ void parent_run_command(Command cmd)
 		case KILL:
 			run_kill(cmd.kill);
 			break;
+
+		case HASH:
+			run_hash(cmd.hash);
+			break;
+
+		case FG:
+			run_fg(cmd.job_ctl);
+			break;
+
+		case BG:
+			run_bg(cmd.job_ctl);
+			break;
+
+		case WAIT:
+			run_wait(cmd.job_ctl);
+			break;
 		case GENERIC:
 			break;
 		case ECHO:
@@ -344,6 +1329,269 @@ void parent_run_command(Command cmd)
 	}
 }
 
+// Size of the regular file a stage streams to its output: the file of a plain
+// cat, or a redirected stdin. 0 if it reads neither.
+static off_t stage_file_size(CommandHolder holder)
+{
+	const char *path = NULL;
+	struct stat st;
+
+	if (get_command_holder_type(holder) == GENERIC && is_plain_cat(holder.cmd.generic))
+		path = holder.cmd.generic.args[1];
+	if (path == NULL && (holder.flags & REDIRECT_IN))
+		path = holder.redirect_in;
+
+	if (path == NULL || stat(path, &st) == -1 || !S_ISREG(st.st_mode))
+		return 0;
+
+	return st.st_size;
+}
+
+/**
+ * @brief Creates every pipe of a pipeline before any of its stages starts
+ *
+ * The pipes are close-on-exec, so a stage that execs keeps only the ends it
+ * was given as stdin and stdout. Forked stages that do not exec close the rest
+ * with @a close_pipeline().
+ *
+ * @param holders The commands of the pipeline
+ *
+ * @param stages Number of commands in the pipeline
+ */
+static void open_pipeline(CommandHolder *holders, size_t stages)
+{
+	size_t n = stages > 0 ? stages - 1 : 0;
+
+	if (n > pipeline_cap)
+	{
+		size_t cap = pipeline_cap ? 2 * pipeline_cap : 8;
+		while (cap < n)
+			cap *= 2;
+
+		int (*table)[2] = realloc(pipeline, cap * sizeof(pipeline[0]));
+		if (table == NULL)
+		{
+			perror("ERROR: Failed to grow the pipe table");
+			exit(EXIT_FAILURE);
+		}
+
+		pipeline = table;
+		pipeline_cap = cap;
+	}
+
+	for (pipeline_len = 0; pipeline_len < n; pipeline_len++)
+	{
+		if (pipe2(pipeline[pipeline_len], O_CLOEXEC) == -1)
+		{
+			perror("Pipe Error");
+			exit(EXIT_FAILURE);
+		}
+
+		// Only a stage copying a large file out gains from a bigger pipe: it can
+		// run further ahead of its reader. Other pipes keep the default size, so
+		// long pipelines do not use up the per-user pipe allowance. The default
+		// is also kept if the kernel refuses.
+		off_t size = stage_file_size(holders[pipeline_len]);
+		if (size > PIPE_DEFAULT_SIZE)
+			fcntl(pipeline[pipeline_len][WRITE], F_SETPIPE_SZ,
+				size < PIPE_BUFFER_SIZE ? (int)size : PIPE_BUFFER_SIZE);
+	}
+}
+
+/**
+ * @brief Closes both ends of every pipe of the pipeline
+ *
+ * Quash calls this once all stages have started, so that each pipe is left
+ * open only in the two stages it connects.
+ */
+static void close_pipeline()
+{
+	for (size_t i = 0; i < pipeline_len; i++)
+	{
+		close(pipeline[i][READ]);
+		close(pipeline[i][WRITE]);
+	}
+
+	pipeline_len = 0;
+}
+
+/**
+ * @brief Starts a @a GENERIC command with posix_spawnp() rather than fork()
+ *
+ * The redirects and pipe ends @a create_process() would set up in a forked
+ * child are described as spawn file actions instead, so the quash process is
+ * never copied just to be replaced by exec.
+ *
+ * @param holder The CommandHolder of a @a GENERIC command
+ *
+ * @param pipe_in Pipe end to read stdin from, or -1
+ *
+ * @param pipe_out Pipe end to write stdout to, or -1
+ *
+ * @param own_group Whether the process goes in the process group of its job
+ * rather than quash's
+ *
+ * @param pgid Process group of the job, or 0 to start one led by the process
+ *
+ * @return The pid of the new process, or -1 if it could not be started
+ */
+static pid_t spawn_process(CommandHolder holder, int pipe_in, int pipe_out, bool own_group, pid_t pgid)
+{
+	bool r_in = holder.flags & REDIRECT_IN;
+	bool r_out = holder.flags & REDIRECT_OUT;
+	bool r_app = holder.flags & REDIRECT_APPEND;
+
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	pid_t pid;
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawnattr_init(&attr);
+
+	if (r_in)
+		posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, holder.redirect_in, O_RDONLY, 0);
+	if (r_out)
+		posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, holder.redirect_out,
+				O_WRONLY | O_CREAT | (r_app ? O_APPEND : O_TRUNC), 0666);
+
+	// Every pipe is close-on-exec, so the ends are only duplicated
+	if (pipe_in != -1)
+		posix_spawn_file_actions_adddup2(&actions, pipe_in, STDIN_FILENO);
+	if (pipe_out != -1)
+		posix_spawn_file_actions_adddup2(&actions, pipe_out, STDOUT_FILENO);
+
+	short flags = 0;
+
+	if (job_events != -1)
+	{
+		posix_spawnattr_setsigmask(&attr, &child_sigmask);
+		flags |= POSIX_SPAWN_SETSIGMASK;
+	}
+
+	if (own_group)
+	{
+		posix_spawnattr_setpgroup(&attr, pgid);
+		flags |= POSIX_SPAWN_SETPGROUP;
+	}
+
+	if (job_control)
+	{
+		sigset_t defaults;
+		sigemptyset(&defaults);
+		for (size_t i = 0; i < NUM_JOB_CONTROL_SIGNALS; i++)
+			sigaddset(&defaults, job_control_signals[i]);
+
+		posix_spawnattr_setsigdefault(&attr, &defaults);
+		flags |= POSIX_SPAWN_SETSIGDEF;
+	}
+
+	posix_spawnattr_setflags(&attr, flags);
+
+	char **args = holder.cmd.generic.args;
+	const char *path = resolve_command(args[0], true);
+	int err = path != NULL ?
+		posix_spawn(&pid, path, &actions, &attr, args, environ) :
+		posix_spawnp(&pid, args[0], &actions, &attr, args, environ);
+
+	// A redirect that cannot be opened fails with ENOENT as well, so only
+	// search PATH once more if the cached path really went away
+	if (err == ENOENT && path != NULL && access(path, X_OK) == -1)
+	{
+		forget_command(args[0]);
+		path = resolve_command(args[0], true);
+		err = path != NULL ?
+			posix_spawn(&pid, path, &actions, &attr, args, environ) :
+			posix_spawnp(&pid, args[0], &actions, &attr, args, environ);
+	}
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (err != 0)
+	{
+		// The file actions run before the exec, so with the program in place
+		// the failure was opening a redirect (ENOEXEC and E2BIG come from the
+		// exec itself)
+		const char *exe = path != NULL ? path : strchr(args[0], '/') != NULL ? args[0] : NULL;
+		bool open_failed = (r_in || r_out) && err != ENOEXEC && err != E2BIG &&
+			exe != NULL && access(exe, X_OK) == 0;
+
+		errno = err;
+		perror(open_failed ? "ERROR: Failed to open file" : "ERROR: Failed to execute program");
+		return -1;
+	}
+
+	return pid;
+}
+
+/**
+ * @brief Runs a builtin in the quash process itself rather than in a child
+ *
+ * Redirects are applied to quash's own stdin and stdout for the duration of
+ * the command, keeping a @a dup() of each descriptor so it can be put back
+ * with @a dup2() once the command returns.
+ *
+ * @param holder The CommandHolder of any command other than @a GENERIC
+ */
+static void run_in_process(CommandHolder holder)
+{
+	bool r_in = holder.flags & REDIRECT_IN;
+	bool r_out = holder.flags & REDIRECT_OUT;
+	bool r_app = holder.flags & REDIRECT_APPEND;
+
+	int saved_in = -1;
+	int saved_out = -1;
+
+	// Anything quash printed so far belongs to the old stdout
+	fflush(stdout);
+
+	if (r_in)
+	{
+		int fd = open(holder.redirect_in, O_RDONLY);
+		if (fd == -1)
+		{
+			perror("ERROR: Failed to open file");
+			return;
+		}
+		saved_in = dup(STDIN_FILENO);
+		dup2(fd, STDIN_FILENO);
+		close(fd);
+	}
+
+	if (r_out)
+	{
+		int fd = open(holder.redirect_out, O_WRONLY | O_CREAT | (r_app ? O_APPEND : O_TRUNC), 0666);
+		if (fd == -1)
+		{
+			perror("ERROR: Failed to open file");
+		}
+		else
+		{
+			saved_out = dup(STDOUT_FILENO);
+			dup2(fd, STDOUT_FILENO);
+			close(fd);
+		}
+	}
+
+	if (!r_out || saved_out != -1)
+	{
+		child_run_command(holder.cmd);
+		parent_run_command(holder.cmd);
+		fflush(stdout);
+	}
+
+	if (saved_out != -1)
+	{
+		dup2(saved_out, STDOUT_FILENO);
+		close(saved_out);
+	}
+	if (saved_in != -1)
+	{
+		dup2(saved_in, STDIN_FILENO);
+		close(saved_in);
+	}
+}
+
 /**
  * @brief Creates one new process centered around the @a Command in the @a
  * CommandHolder setting up redirects and pipes where needed
@@ -357,9 +1605,14 @@ void parent_run_command(Command cmd)
  *
  * @param holder The CommandHolder to try to run
  *
+ * @param cJob The job the process belongs to
+ *
+ * @param stage Position of the command in its pipeline, which selects its pipe
+ * ends from those @a open_pipeline() created
+ *
  * @sa Command CommandHolder
  */
-void create_process(CommandHolder holder, Job *cJob)
+void create_process(CommandHolder holder, Job *cJob, size_t stage)
 {
 
 	// Read the flags field from the parser
@@ -369,51 +1622,78 @@ void create_process(CommandHolder holder, Job *cJob)
 	bool r_out = holder.flags & REDIRECT_OUT;
 	bool r_app = holder.flags & REDIRECT_APPEND; // This can only be true if r_out is true
 
-	if (p_out)
+	// Builtins need no process of their own unless they are part of a
+	// pipeline or run in the background
+	CommandType type = get_command_holder_type(holder);
+	if (type != GENERIC && !p_in && !p_out && !(holder.flags & BACKGROUND))
 	{
-		if (pipe(environment_pipes[next_pipe]) == -1)
-		{
-			perror("Pipe Error");
-			exit(EXIT_FAILURE);
-		}
+		run_in_process(holder);
+		return;
 	}
 
+	int pipe_in = p_in ? pipeline[stage - 1][READ] : -1;
+	int pipe_out = p_out ? pipeline[stage][WRITE] : -1;
+
 	pid_t pid_0;
 
-	pid_0 = fork();
+	// With job control every job gets a process group. Without it only
+	// background jobs do, so that kill can signal them as a whole, and
+	// foreground jobs stay with quash and its terminal.
+	bool background = holder.flags & BACKGROUND;
+	bool own_group = job_control || background;
+
+	// External commands need nothing from the quash process, so spawn them
+	// without copying it. Builtins still fork to run in the child, as does a
+	// plain cat with a pipe end, which splices instead of running the cat
+	// program. Without a pipe there is nothing to splice to or from.
+	bool splices = type == GENERIC && (p_in || p_out) && is_plain_cat(holder.cmd.generic);
+	if (type == GENERIC && !splices)
+		pid_0 = spawn_process(holder, pipe_in, pipe_out, own_group, cJob->pgid);
+	else
+		pid_0 = fork();
+
 	/*Child*/
 	if (pid_0 == 0)
 	{
+		if (own_group)
+			setpgid(0, cJob->pgid);
+
+		if (job_control)
+			for (size_t i = 0; i < NUM_JOB_CONTROL_SIGNALS; i++)
+				signal(job_control_signals[i], SIG_DFL);
+
+		if (job_events != -1)
+			sigprocmask(SIG_SETMASK, &child_sigmask, NULL);
+
 		if (r_in)
 		{
 			FILE *r_input = fopen(holder.redirect_in, "r");
+			if (r_input == NULL)
+			{
+				perror("ERROR: Failed to open file");
+				exit(EXIT_FAILURE);
+			}
 			dup2(fileno(r_input), STDIN_FILENO);
 		}
 		if (r_out)
 		{
-			if (r_app)
-			{
-				FILE *r_output = fopen(holder.redirect_out, "a");
-				dup2(fileno(r_output), STDOUT_FILENO);
-			}
-			else
+			FILE *r_output = fopen(holder.redirect_out, r_app ? "a" : "w");
+			if (r_output == NULL)
 			{
-				FILE *r_output = fopen(holder.redirect_out, "w");
-				dup2(fileno(r_output), STDOUT_FILENO);
+				perror("ERROR: Failed to open file");
+				exit(EXIT_FAILURE);
 			}
+			dup2(fileno(r_output), STDOUT_FILENO);
 		}
 
 		if (p_in)
-		{
-			dup2(environment_pipes[prev_pipe][READ], STDIN_FILENO);
-			close(environment_pipes[prev_pipe][WRITE]);
-		}
-
+			dup2(pipe_in, STDIN_FILENO);
 		if (p_out)
-		{
-			dup2(environment_pipes[next_pipe][WRITE], STDOUT_FILENO);
-			close(environment_pipes[next_pipe][READ]);
-		}
+			dup2(pipe_out, STDOUT_FILENO);
+
+		// A builtin or a splicing cat never execs, so the pipes it does not
+		// use would otherwise stay open until it exits
+		close_pipeline();
 
 		/* Run child command */
 		child_run_command(holder.cmd); // This should be done in the child branch of a fork
@@ -421,19 +1701,27 @@ void create_process(CommandHolder holder, Job *cJob)
 	}
 	else
 	{
-		if (p_in)
-		{
-			close(environment_pipes[prev_pipe][READ]);
-		}
-		if (p_out)
+		if (pid_0 > 0)
 		{
-			close(environment_pipes[next_pipe][WRITE]);
-		}
+			push_front_PID_QUEUE(&cJob->pid_queue, pid_0);
 
-		next_pipe = (next_pipe + 1) % 2;
-		prev_pipe = (prev_pipe + 1) % 2;
+			if (cJob->usage != NULL)
+				cJob->usage[stage].pid = pid_0;
 
-		push_front_PID_QUEUE(&cJob->pid_queue, pid_0);
+			if (own_group)
+			{
+				// Also done here so the group exists before the next process
+				// joins it, whichever of parent and child runs first
+				setpgid(pid_0, cJob->pgid ? cJob->pgid : pid_0);
+
+				if (cJob->pgid == 0)
+				{
+					cJob->pgid = pid_0;
+					if (!background)
+						give_terminal(pid_0);
+				}
+			}
+		}
 
 		/* Run parent command */
 		parent_run_command(holder.cmd); // This should be done in the parent branch of a fork
@@ -446,11 +1734,6 @@ void run_script(CommandHolder *holders)
 	if (holders == NULL)
 		return;
 
-	if (init_flag) {
-		job_queue_pointer = new_JOB_QUEUE(1);
-		init_flag = false;
-	}
-
 	check_jobs_bg_status();
 
 	if (get_command_holder_type(holders[0]) == EXIT &&
@@ -461,36 +1744,78 @@ void run_script(CommandHolder *holders)
 	}
 
 	Job new_job;
+	new_job.pgid = 0;
 	new_job.pid_queue = new_PID_QUEUE (1);
+	new_job.stopped = false;
+	new_job.cmd = NULL;
+
+	size_t stages = 0;
+	while (get_command_holder_type(holders[stages]) != EOC)
+		stages++;
+
+	job_usage_start(&new_job, holders, stages);
+
+	// A builtin quash runs itself is accounted from quash's own usage
+	struct rusage self;
+	if (new_job.usage != NULL)
+		getrusage(RUSAGE_SELF, &self);
+
+	// Set up the whole pipeline before starting any of it, then start every
+	// command and close quash's copies of the pipes in one go
+	open_pipeline(holders, stages);
+
+	for (size_t i = 0; i < stages; ++i)
+		create_process(holders[i], &new_job, i);
 
-	CommandType type;
+	close_pipeline();
 
-	// Run all commands in the `holder` array
-	for (int i = 0; (type = get_command_holder_type(holders[i])) != EOC; ++i)
-		create_process(holders[i], &new_job);
+	if (is_empty_PID_QUEUE(&new_job.pid_queue))
+	{
+		// Nothing was left running: the commands were builtins run by quash
+		// itself or could not be started
+		if (new_job.usage != NULL && new_job.usage[0].pid == 0 &&
+				get_command_holder_type(holders[0]) != GENERIC)
+			job_usage_in_process(&new_job, &self);
+		finish_job_usage(&new_job, NULL);
+
+		destroy_PID_QUEUE(&new_job.pid_queue);
+		return;
+	}
 
 	if (!(holders[0].flags & BACKGROUND))
 	{
 		// Not a background Job
-		// Wait for all processes under the job to complete
-		while(!(is_empty_PID_QUEUE(&new_job.pid_queue))) {
-			pid_t temp_pid = pop_front_PID_QUEUE(&new_job.pid_queue);
-			int wait;
-			waitpid(temp_pid, &wait, 0);
-		}
+		// Wait for all processes under the job to complete. Background jobs
+		// are in process groups of their own, so they are left for
+		// check_jobs_bg_status().
+		new_job.stopped = wait_for_job(&new_job, length_PID_QUEUE(&new_job.pid_queue)) > 0;
+		take_terminal();
 
-		destroy_PID_QUEUE (&new_job.pid_queue);
+		if (new_job.stopped)
+		{
+			// Keep a stopped job in the job table so fg or bg can continue it
+			new_job.cmd = get_command_string ();
+			new_job.job_id = last_job + 1;
+			Job *job = add_job(new_job);
+			print_job_stopped(job->job_id, peek_front_PID_QUEUE(&job->pid_queue), job->cmd);
+		}
+		else
+		{
+			fflush(stdout);
+			finish_job_usage(&new_job, NULL);
+			destroy_PID_QUEUE (&new_job.pid_queue);
+		}
 	}
 	else
 	{
 		new_job.cmd = get_command_string ();
-		new_job.job_id = length_JOB_QUEUE (&job_queue_pointer) + 1;
+		new_job.job_id = last_job + 1;
 
 		// Once jobs are implemented, uncomment and fill the following line
 		print_job_bg_start(new_job.job_id, peek_front_PID_QUEUE(&new_job.pid_queue), new_job.cmd);
 
 		// A background job.
-		// Push the new job to the job queue
-		push_back_JOB_QUEUE(&job_queue_pointer, new_job);
+		// Add the new job to the job table
+		add_job(new_job);
 	}
 }
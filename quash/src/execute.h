@@ -21,6 +21,19 @@
  */
 const char* lookup_env(const char* env_var);
 
+/**
+ * @brief Function to get environment variable values by a name that need not
+ * be NUL terminated
+ *
+ * @param env_var Start of the name of the environment variable to lookup
+ *
+ * @param len Length of the name
+ *
+ * @return String containing the value of the environment variable, or NULL if
+ * it is not set
+ */
+const char* lookup_env_n(const char* env_var, size_t len);
+
 /**
  * @brief Function to set and define environment variable values
  *
@@ -48,6 +61,23 @@ char* get_current_directory(bool* should_free);
  */
 void check_jobs_bg_status();
 
+/**
+ * @brief Reap background processes that have exited without reporting them
+ *
+ * @return The number of completed jobs @a check_jobs_bg_status() will report
+ */
+size_t reap_jobs_bg();
+
+/**
+ * @brief Get a file descriptor that polls readable when a child exits
+ *
+ * The first call blocks SIGCHLD in Quash and reads it through a signalfd.
+ * Children are started with the original signal mask.
+ *
+ * @return The file descriptor, or -1 if it could not be created
+ */
+int job_event_fd();
+
 /**
  * @brief Print a job to standard out
  *
@@ -91,6 +121,28 @@ void print_job_bg_start(int job_id, pid_t pid, const char* cmd);
  */
 void print_job_bg_complete(int job_id, pid_t pid, const char* cmd);
 
+/**
+ * @brief Print that a job was stopped to standard out
+ *
+ * @param job_id Job identifier number.
+ *
+ * @param pid Process id of a process belonging to this job.
+ *
+ * @param cmd String holding an aproximation of what the user typed in for the
+ * command.
+ */
+void print_job_stopped(int job_id, pid_t pid, const char* cmd);
+
+/**
+ * @brief Take control of the terminal for interactive use
+ *
+ * Puts quash in a process group of its own that owns the terminal and ignores
+ * the terminal signals. From then on every job runs in a process group of its
+ * own, which gets the terminal while it is in the foreground. Does nothing if
+ * standard in is not a terminal.
+ */
+void init_job_control();
+
 /**
  * @brief Run a generic (non-builtin) command
  *
@@ -150,6 +202,59 @@ void run_pwd();
  */
 void run_jobs();
 
+/**
+ * @brief Run the builtin hash command to update the table of resolved command
+ * paths
+ *
+ * `hash -r` empties the table and every other argument is looked up through
+ * the PATH environment variable and added to it.
+ *
+ * @param cmd A @a HashCommand
+ *
+ * @sa HashCommand, run_hash_list()
+ */
+void run_hash(HashCommand cmd);
+
+/**
+ * @brief Print the table of resolved command paths, as hash without arguments
+ * does
+ *
+ * @sa HashCommand, run_hash()
+ */
+void run_hash_list();
+
+/**
+ * @brief Run the builtin fg command to continue a job in the foreground
+ *
+ * The job is the one named by the first argument, as `%n` or `n`, or the most
+ * recent job.
+ *
+ * @param cmd A @a JobControlCommand
+ *
+ * @sa JobControlCommand
+ */
+void run_fg(JobControlCommand cmd);
+
+/**
+ * @brief Run the builtin bg command to continue a stopped job in the
+ * background
+ *
+ * @param cmd A @a JobControlCommand
+ *
+ * @sa JobControlCommand, run_fg()
+ */
+void run_bg(JobControlCommand cmd);
+
+/**
+ * @brief Run the builtin wait command to wait for the named job, or every
+ * running background job, to complete
+ *
+ * @param cmd A @a JobControlCommand
+ *
+ * @sa JobControlCommand
+ */
+void run_wait(JobControlCommand cmd);
+
 /**
  * @brief Common entry point for all commands
  *
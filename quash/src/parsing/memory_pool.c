@@ -1,6 +1,8 @@
 #include "memory_pool.h"
 
 #include <assert.h>
+#include <stdalign.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -31,6 +33,21 @@ IMPLEMENT_DEQUE(MemoryPoolDeque, MemoryPool);
 
 static MemoryPoolDeque pool_deq = { NULL, 0, 0, 0, NULL };
 
+// Number of resets in a row a grown pool may go mostly unused before it is
+// given back
+#define POOL_IDLE_RESETS 256
+
+static size_t pool_init_size = 0;  // size passed to initialize_memory_pool()
+static unsigned pool_idle_resets = 0;
+
+// Every allocation is rounded up to this so returned pointers suit any type
+#define POOL_ALIGN (alignof(max_align_t))
+
+// Bump pointer and end of the block at the back of pool_deq. The block's own
+// next field is only brought up to date when the block is left.
+static char* pool_next = NULL;
+static char* pool_end = NULL;
+
 // Creates a single memory pool an returns a copy If the `size` parameter is
 // zero then this function will not allocate any space for later MemoryPool
 // allocations.
@@ -74,6 +91,19 @@ static MemoryPool __low_memory_initialize_memory_pool(size_t required_size,
   }
 }
 
+// Record how much of the block being carved up has been handed out
+static void __sync_current_pool() {
+  MemoryPool pool = peek_back_MemoryPoolDeque(&pool_deq);
+  pool.next = pool_next;
+  update_back_MemoryPoolDeque(&pool_deq, pool);
+}
+
+// Make pool the block the fast path allocates from
+static void __use_pool(MemoryPool pool) {
+  pool_next = pool.next;
+  pool_end = (char*) pool.pool + pool.size;
+}
+
 static void __destroy_memory_pool(MemoryPool mp) {
   if (mp.pool != NULL)
     free(mp.pool);
@@ -84,6 +114,9 @@ void initialize_memory_pool(size_t size) {
   if (size == 0)
     size = 1;
 
+  pool_init_size = size;
+  pool_idle_resets = 0;
+
   pool_deq = new_destructable_MemoryPoolDeque(10, __destroy_memory_pool);
 
   MemoryPool pool = __initialize_memory_pool(size);
@@ -93,55 +126,123 @@ void initialize_memory_pool(size_t size) {
     pool = __low_memory_initialize_memory_pool(1, size);
 
   push_back_MemoryPoolDeque(&pool_deq, pool);
+  __use_pool(pool);
 }
 
-void* memory_pool_alloc(size_t size) {
+// Slow path of memory_pool_alloc(): the current block is full, so start a new
+// one large enough to hold size bytes
+static __attribute__((noinline)) void* __memory_pool_alloc_slow(size_t size) {
   assert(!is_empty_MemoryPoolDeque(&pool_deq));
 
-  MemoryPool pool = peek_back_MemoryPoolDeque(&pool_deq);
+  __sync_current_pool();
+
+  // Each new block doubles the size of the last so long commands need only a
+  // few of them
   size_t init_size = peek_front_MemoryPoolDeque(&pool_deq).size;
+  size_t new_pool_size = init_size * (2 << (length_MemoryPoolDeque(&pool_deq) - 1));
 
-  assert(pool.pool != NULL);
-  assert(pool.size != 0);
-  assert(pool.next != NULL);
-
-  while (pool.next - pool.pool + size > pool.size) {
-    // There is not enough room in the current memory pool to fit the
-    // allocation. Create a new memory pool large enough to hold it. 
-    size_t length_pool_deq = length_MemoryPoolDeque(&pool_deq);
-    size_t new_pool_size = init_size * (2 << (length_pool_deq - 1));
-
-    if (new_pool_size < size) {
-      // The next pool size selected wasn't enough space. We have to have to add
-      // something onto the deque since the new pool size is dependent on the
-      // size of the deque.
-      pool = __initialize_memory_pool(0);
-    }
-    else {
-      // Create a MemoryPool with the correct amount of space
-      pool = __initialize_memory_pool(new_pool_size);
+  while (new_pool_size < size)
+    new_pool_size *= 2;
 
-      if (pool.pool == NULL)
-        // We are running low on memory. Try smaller allocations or exit Quash
-        pool = __low_memory_initialize_memory_pool(size, new_pool_size);
-    }
+  MemoryPool pool = __initialize_memory_pool(new_pool_size);
 
-    push_back_MemoryPoolDeque(&pool_deq, pool);
-  }
+  if (pool.pool == NULL)
+    // We are running low on memory. Try smaller allocations or exit Quash
+    pool = __low_memory_initialize_memory_pool(size, new_pool_size);
 
-  assert(pool.next == peek_back_MemoryPoolDeque(&pool_deq).next);
-  void* ret = pool.next;
-  pool.next += size;
+  push_back_MemoryPoolDeque(&pool_deq, pool);
+  __use_pool(pool);
 
-  // Update record
-  update_back_MemoryPoolDeque(&pool_deq, pool);
+  void* ret = pool_next;
+  pool_next += size;
 
   return ret;
 }
 
+void* memory_pool_alloc(size_t size) {
+  size = (size + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+
+  if ((size_t) (pool_end - pool_next) < size)
+    return __memory_pool_alloc_slow(size);
+
+  void* ret = pool_next;
+  pool_next += size;
+
+  return ret;
+}
+
+// Remember the current allocation point
+MemoryPoolMark memory_pool_mark() {
+  assert(!is_empty_MemoryPoolDeque(&pool_deq));
+
+  return (MemoryPoolMark) {
+    length_MemoryPoolDeque(&pool_deq),
+    pool_next
+  };
+}
+
+// Roll the memory pool back to a mark, freeing blocks started after it
+void memory_pool_release(MemoryPoolMark mark) {
+  assert(mark.pools <= length_MemoryPoolDeque(&pool_deq));
+
+  while (length_MemoryPoolDeque(&pool_deq) > mark.pools)
+    __destroy_memory_pool(pop_back_MemoryPoolDeque(&pool_deq));
+
+  MemoryPool pool = peek_back_MemoryPoolDeque(&pool_deq);
+  pool.next = mark.next;
+  update_back_MemoryPoolDeque(&pool_deq, pool);
+  __use_pool(pool);
+}
+
 // Free all memory contained in the MemoryPoolDeque
 void destroy_memory_pool() {
   destroy_MemoryPoolDeque(&pool_deq);
+  pool_next = pool_end = NULL;
+}
+
+// Rewind the memory pool to a single empty block, keeping the largest one
+void memory_pool_reset() {
+  assert(!is_empty_MemoryPoolDeque(&pool_deq));
+
+  __sync_current_pool();
+
+  MemoryPool keep = __initialize_memory_pool(0);
+  size_t used = 0;
+
+  while (!is_empty_MemoryPoolDeque(&pool_deq)) {
+    MemoryPool pool = pop_back_MemoryPoolDeque(&pool_deq);
+    used += (char*) pool.next - (char*) pool.pool;
+
+    if (pool.size > keep.size) {
+      __destroy_memory_pool(keep);
+      keep = pool;
+    }
+    else {
+      __destroy_memory_pool(pool);
+    }
+  }
+
+  // A block grown for one large command is given back once commands have
+  // needed no more than a quarter of it for a while
+  if (keep.size > pool_init_size && 4 * used <= keep.size) {
+    if (++pool_idle_resets >= POOL_IDLE_RESETS) {
+      __destroy_memory_pool(keep);
+      keep = __initialize_memory_pool(pool_init_size);
+
+      if (keep.pool == NULL)
+        // We are running low on memory. Try smaller allocations or exit Quash
+        keep = __low_memory_initialize_memory_pool(1, pool_init_size);
+
+      pool_idle_resets = 0;
+    }
+  }
+  else {
+    pool_idle_resets = 0;
+  }
+
+  keep.next = keep.pool;
+  push_back_MemoryPoolDeque(&pool_deq, keep);
+  __use_pool(keep);
 }
 
 // Simple replacement for strdup() that uses the memory pool rather than malloc
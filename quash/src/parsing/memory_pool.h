@@ -24,6 +24,16 @@
 
 #include "deque.h"
 
+/**
+ * @brief A point in the memory pool that it can be rolled back to
+ *
+ * @sa memory_pool_mark(), memory_pool_release()
+ */
+typedef struct MemoryPoolMark {
+  size_t pools; /**< Number of blocks in the memory pool when marked */
+  char* next;   /**< Next address the last of those blocks would hand out */
+} MemoryPoolMark;
+
 /**
  * @brief Allocate the memory pool
  *
@@ -40,15 +50,39 @@ void initialize_memory_pool(size_t size);
  *
  * @param size Size in bytes of the requested reserved space
  *
- * @return A pointer to a unique array of size bytes
+ * @return A pointer to a unique array of size bytes, aligned for any type
  */
 void* memory_pool_alloc(size_t size);
 
+/**
+ * @brief Remember the current point of the memory pool
+ *
+ * @return A mark to pass to memory_pool_release()
+ */
+MemoryPoolMark memory_pool_mark();
+
+/**
+ * @brief Roll the memory pool back to a mark, invalidating every allocation
+ * made since memory_pool_mark() returned it
+ *
+ * @param mark A mark taken since the last reset of the memory pool
+ */
+void memory_pool_release(MemoryPoolMark mark);
+
 /**
  * @brief Free all memory allocated in the memory pool
  */
 void destroy_memory_pool();
 
+/**
+ * @brief Invalidate every allocation in the memory pool while keeping its
+ * largest block for the allocations that follow
+ *
+ * Once the kept block has gone mostly unused for a while it is given back and
+ * replaced with one of the size passed to initialize_memory_pool().
+ */
+void memory_pool_reset();
+
 /**
  * @brief A version of strdup() that allocates the duplicate to the memory pool
  * rather than with malloc directly
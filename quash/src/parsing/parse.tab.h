@@ -1,8 +1,9 @@
-/* A Bison parser, made by GNU Bison 3.0.4.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 /* Bison interface for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989-1990, 2000-2015 Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
    This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
@@ -15,7 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -30,6 +31,10 @@
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 #ifndef YY_YY_SRC_PARSING_PARSE_TAB_H_INCLUDED
 # define YY_YY_SRC_PARSING_PARSE_TAB_H_INCLUDED
 /* Debug traces.  */
@@ -40,7 +45,7 @@
 extern int yydebug;
 #endif
 /* "%code requires" blocks.  */
-#line 22 "src/parsing/parse.y" /* yacc.c:1909  */
+#line 39 "src/parsing/parse.y"
 
 #include <stdbool.h>
 
@@ -49,42 +54,46 @@ extern int yydebug;
 #include "parse.tab.h"
 #include "memory_pool.h"
 
-#line 53 "src/parsing/parse.tab.h" /* yacc.c:1909  */
+#line 58 "src/parsing/parse.tab.h"
 
-/* Token type.  */
+/* Token kinds.  */
 #ifndef YYTOKENTYPE
 # define YYTOKENTYPE
   enum yytokentype
   {
-    PIPE = 258,
-    BCKGRND = 259,
-    SQUOTE = 260,
-    EQUALS = 261,
-    REDIRIN = 262,
-    REDIROUT = 263,
-    REDIROUTAPP = 264,
-    END = 265,
-    ECHO_TOK = 266,
-    EXPORT_TOK = 267,
-    CD_TOK = 268,
-    PWD_TOK = 269,
-    JOBS_TOK = 270,
-    KILL_TOK = 271,
-    EOC_TOK = 272,
-    STR = 273,
-    SIM_STR = 274,
-    ID = 275,
-    NUM = 276,
-    EXIT_TOK = 277
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    PIPE = 258,                    /* PIPE  */
+    BCKGRND = 259,                 /* BCKGRND  */
+    SQUOTE = 260,                  /* SQUOTE  */
+    EQUALS = 261,                  /* EQUALS  */
+    REDIRIN = 262,                 /* REDIRIN  */
+    REDIROUT = 263,                /* REDIROUT  */
+    REDIROUTAPP = 264,             /* REDIROUTAPP  */
+    END = 265,                     /* END  */
+    ECHO_TOK = 266,                /* ECHO_TOK  */
+    EXPORT_TOK = 267,              /* EXPORT_TOK  */
+    CD_TOK = 268,                  /* CD_TOK  */
+    PWD_TOK = 269,                 /* PWD_TOK  */
+    JOBS_TOK = 270,                /* JOBS_TOK  */
+    KILL_TOK = 271,                /* KILL_TOK  */
+    EOC_TOK = 272,                 /* EOC_TOK  */
+    STR = 273,                     /* STR  */
+    SIM_STR = 274,                 /* SIM_STR  */
+    ID = 275,                      /* ID  */
+    NUM = 276,                     /* NUM  */
+    EXIT_TOK = 277                 /* EXIT_TOK  */
   };
+  typedef enum yytokentype yytoken_kind_t;
 #endif
 
 /* Value type.  */
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-
 union YYSTYPE
 {
-#line 31 "src/parsing/parse.y" /* yacc.c:1909  */
+#line 48 "src/parsing/parse.y"
 
   int integer;
   char* str;
@@ -95,9 +104,9 @@ union YYSTYPE
   Cmds cmd_list;
   Redirect redirect;
 
-#line 99 "src/parsing/parse.tab.h" /* yacc.c:1909  */
-};
+#line 108 "src/parsing/parse.tab.h"
 
+};
 typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
 # define YYSTYPE_IS_DECLARED 1
@@ -106,6 +115,8 @@ typedef union YYSTYPE YYSTYPE;
 
 extern YYSTYPE yylval;
 
+
 int yyparse (CommandHolder** __ret_cmds);
 
+
 #endif /* !YY_YY_SRC_PARSING_PARSE_TAB_H_INCLUDED  */
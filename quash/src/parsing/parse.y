@@ -17,6 +17,23 @@ extern int yyparse(CommandHolder**);
 extern int yylex();
 
 int yyerrstatus = 0;
+
+// Set when the command being parsed was prefixed with time, until the
+// command's holder takes it as the TIMED flag
+static bool timed_cmd = false;
+
+// The directory a cd changes to, or NULL if it does not exist
+static char* cd_target(const char* dir) {
+  char* resolved_path;
+  char* ret = NULL;
+
+  if ((resolved_path = realpath(dir, NULL)) != NULL) {
+    ret = memory_pool_strdup(resolved_path);
+    free(resolved_path);
+  }
+
+  return ret;
+}
 %}
 
 %code requires {
@@ -66,6 +83,14 @@ top:    EOC_TOK {
 
   YYACCEPT;
 }
+|       END {
+  // Input that ends with a newline, or is empty, has nothing left to run
+  *__ret_cmds = NULL;
+
+  end_main_loop(EXIT_SUCCESS);
+
+  YYACCEPT;
+}
 |       cmds EOC_TOK {
   push_back_Cmds(&$1, mk_command_holder(NULL, NULL, 0, mk_eoc()));
 
@@ -84,11 +109,13 @@ top:    EOC_TOK {
 }
 |       error EOC_TOK {
   *__ret_cmds = NULL;
+  timed_cmd = false;
 
   YYABORT;
 }
 |       error END {
   *__ret_cmds = NULL;
+  timed_cmd = false;
 
   end_main_loop(EXIT_FAILURE);
 
@@ -125,7 +152,10 @@ cmd_top: cmd_content redir cmd_bg {
   char flags = (($2.append)? REDIRECT_APPEND : 0) |
     (($2.out)? REDIRECT_OUT : 0) |
     (($2.in)? REDIRECT_IN : 0) |
-    ($3? BACKGROUND : 0);
+    ($3? BACKGROUND : 0) |
+    (timed_cmd? TIMED : 0);
+
+  timed_cmd = false;
 
   $$ = mk_command_holder($2.in, $2.out, flags, $1);
 }
@@ -133,7 +163,36 @@ cmd_top: cmd_content redir cmd_bg {
 
 
 cmd_content: cmd {
-  $$ = mk_generic_command(as_array_CmdStrs(&$1, NULL));
+  char** args = as_array_CmdStrs(&$1, NULL);
+
+  // A leading time is a prefix for the rest of the words rather than a
+  // command
+  if (strcmp(args[0], "time") == 0 && args[1] != NULL) {
+    timed_cmd = true;
+    ++args;
+  }
+
+  // These builtins have no token of their own; they are picked out by their
+  // first word
+  if (strcmp(args[0], "hash") == 0)
+    $$ = mk_hash_command(args + 1);
+  else if (strcmp(args[0], "fg") == 0)
+    $$ = mk_job_control_command(FG, args + 1);
+  else if (strcmp(args[0], "bg") == 0)
+    $$ = mk_job_control_command(BG, args + 1);
+  else if (strcmp(args[0], "wait") == 0)
+    $$ = mk_job_control_command(WAIT, args + 1);
+  // After time, the builtins with tokens of their own arrive as plain words
+  else if (timed_cmd && strcmp(args[0], "echo") == 0)
+    $$ = mk_echo_command(args + 1);
+  else if (timed_cmd && strcmp(args[0], "cd") == 0)
+    $$ = mk_cd_command(cd_target(args[1] != NULL ? args[1] : lookup_env("HOME")));
+  else if (timed_cmd && strcmp(args[0], "pwd") == 0)
+    $$ = mk_pwd_command();
+  else if (timed_cmd && strcmp(args[0], "jobs") == 0)
+    $$ = mk_jobs_command();
+  else
+    $$ = mk_generic_command(args);
 }
 |       ECHO_TOK {
   char** cmd = memory_pool_alloc(sizeof(char*));
@@ -150,15 +209,7 @@ cmd_content: cmd {
   $$ = mk_cd_command(memory_pool_strdup(lookup_env("HOME")));
 }
 |       CD_TOK string {
-  char* resolved_path;
-  char* ret = NULL;
-
-  if ((resolved_path = realpath($2, NULL)) != NULL) {
-    ret = memory_pool_strdup(resolved_path);
-    free(resolved_path);
-  }
-
-  $$ = mk_cd_command(ret);
+  $$ = mk_cd_command(cd_target($2));
 }
 |       PWD_TOK {
   $$ = mk_pwd_command();
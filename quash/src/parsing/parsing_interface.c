@@ -1,24 +1,33 @@
 #include "parsing_interface.h"
 
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "memory_pool.h"
 #include "parse.tab.h"
 
 IMPLEMENT_DEQUE_STRUCT(SizeStack, size_t);
-IMPLEMENT_DEQUE_STRUCT(StrBuilder, char);
-IMPLEMENT_DEQUE_STRUCT(MPStrBuilder, char);
 
 IMPLEMENT_DEQUE(SizeStack, size_t);
-IMPLEMENT_DEQUE(StrBuilder, char);
-IMPLEMENT_DEQUE_MEMORY_POOL(MPStrBuilder, char);
 IMPLEMENT_DEQUE_MEMORY_POOL(CmdStrs, char*);
 IMPLEMENT_DEQUE_MEMORY_POOL(Cmds, CommandHolder);
 
 extern void destroy_lex();
 
+// Scanner entry point for reading from memory, defined in lex.yy.c
+typedef struct yy_buffer_state* YY_BUFFER_STATE;
+extern YY_BUFFER_STATE yy_scan_buffer(char* base, size_t size);
+
+// Mapping of the script file being scanned, if any
+static char* script_map = NULL;
+static size_t script_map_len = 0;
+
 // Generate a string based off of a pipable generic command
 static inline void __stringify_generic_cmd(GenericCommand cmd, CmdStrs* strs) {
   // Extract argument strings
@@ -26,6 +35,16 @@ static inline void __stringify_generic_cmd(GenericCommand cmd, CmdStrs* strs) {
     push_back_CmdStrs(strs, cmd.args[i]);
 }
 
+// Generate a string based off of a builtin that is told apart by its first word
+static inline void __stringify_named_cmd(const char* name, GenericCommand cmd,
+                                         CmdStrs* strs) {
+  push_back_CmdStrs(strs, memory_pool_strdup(name));
+
+  // Extract argument strings
+  for (size_t i = 0; cmd.args[i] != NULL; ++i)
+    push_back_CmdStrs(strs, cmd.args[i]);
+}
+
 static inline void __stringify_echo_cmd(EchoCommand cmd, CmdStrs* strs) {
   push_back_CmdStrs(strs, memory_pool_strdup("echo"));
 
@@ -90,6 +109,22 @@ static void __stringify_command(Command cmd, CmdStrs* strs) {
     __stringify_simple_cmd("JOBS", strs);
     break;
 
+  case HASH:
+    __stringify_named_cmd("hash", cmd.hash, strs);
+    break;
+
+  case FG:
+    __stringify_named_cmd("fg", cmd.job_ctl, strs);
+    break;
+
+  case BG:
+    __stringify_named_cmd("bg", cmd.job_ctl, strs);
+    break;
+
+  case WAIT:
+    __stringify_named_cmd("wait", cmd.job_ctl, strs);
+    break;
+
   case EXIT:
     __stringify_simple_cmd("EXIT", strs);
     break;
@@ -100,6 +135,9 @@ static void __stringify_command(Command cmd, CmdStrs* strs) {
 }
 
 static void __stringify_holder(CommandHolder holder, CmdStrs* strs) {
+  if (holder.flags & TIMED)
+    push_back_CmdStrs(strs, memory_pool_strdup("time"));
+
   __stringify_command(holder.cmd, strs);
 
   // Generate redirect symbols and extract file names
@@ -165,72 +203,43 @@ static char* __condense_string_array(char** str_arr) {
   return ret;
 }
 
-// Helper for __interpret_deref: Checks if the character is a valid first
+// Helper for interpret_complex_string_token: Checks if the character is a valid first
 // character for an identifier
 static inline bool __is_first_identifier_char(char c) {
   return isalpha(c) || c == '_';
 }
 
-// Helper for __interpret_deref: Checks if the character is a valid non-leading
+// Helper for interpret_complex_string_token: Checks if the character is a valid non-leading
 // identifier character
 static inline bool __is_identifier_char(char c) {
   return isalnum(c) || c == '_';
 }
 
-// Expand an environment variable onto a string
-static void __interpret_deref(MPStrBuilder* bld, const char* str, int* idx) {
-  assert(str != NULL);
-  assert(str[*idx] == '$');
-  assert(peek_back_MPStrBuilder(bld) == '$');
-
-  // Remove the dereference symbol at the back of the bld deque
-  pop_back_MPStrBuilder(bld);
-
-  StrBuilder tmp = new_StrBuilder(16);
-  char c;
-
-  // Extract the identifier characters. Since this is intended only as a helper
-  // function we assume that interpret_complex_string token has already noticed
-  // a valid first identifier character after the dereference symbol.
-  while (__is_identifier_char((c = str[++(*idx)])))
-    push_back_StrBuilder(&tmp, c);
-
-  // idx increments one too far in the while loop so bring it back down
-  --(*idx);
-
-  // Add the null terminator to the string
-  push_back_StrBuilder(&tmp, '\0');
-
-  // Extract the id string and lookup the environment variable
-  char* id = as_array_StrBuilder(&tmp, NULL);
-  const char* env_var = lookup_env(id);
-
-  free(id);
-
-  // Append env_var to the string builder
-  if (env_var != NULL) {
-    for (int i = 0; env_var[i] != '\0'; ++i)
-      push_back_MPStrBuilder(bld, env_var[i]);
-  }
-}
-
 // Cleans up escapes and unescaped single quotes and expands environment
 // variables found in a string
 char* interpret_complex_string_token(const char* str) {
   assert(str != NULL);
 
-  MPStrBuilder bld = new_MPStrBuilder(64);
-  int i;
-  int len = strlen(str);
+  size_t len = strlen(str);
+  const char* p = str + strcspn(str, "\\'$");
+
+  // Most tokens have nothing to clean up
+  if (*p == '\0')
+    return (char*) str;
+
+  // Without expansions the result is never longer than str
+  size_t cap = len + 1;
+  char* out = memory_pool_alloc(cap);
+  size_t n = p - str;
   bool in_quotes = false;
 
-  for (i = 0; i <= len; ++i) {
-    push_back_MPStrBuilder(&bld, str[i]);
+  memcpy(out, str, n);
 
-    switch (str[i]) {
-    case '\\':                // Remove valid escape characters
+  while (*p != '\0') {
+    switch (*p) {
+    case '\\':               // Remove valid escape characters
       if (!in_quotes) {
-        switch (str[i+1]) {
+        switch (p[1]) {
         case '\\':
         case '\'':
         case '#':
@@ -241,45 +250,80 @@ char* interpret_complex_string_token(const char* str) {
         case ';':
         case ' ':
         case '\t':
-          update_back_MPStrBuilder(&bld, str[++i]);
+          out[n++] = p[1];
+          p += 2;
           break;
 
         case '\n':
-          pop_back_MPStrBuilder(&bld);
-          ++i;
+          p += 2;
           break;
 
         default:
+          out[n++] = *p++;
           break;
         }
       }
-      else if (str[i+1] == '\'') {
-        update_back_MPStrBuilder(&bld, '\'');
-        ++i;
+      else if (p[1] == '\'') {
+        out[n++] = '\'';
+        p += 2;
+      }
+      else {
+        out[n++] = *p++;
       }
       break;
 
     case '\'':                // Remove single quotes and toggle quote state
       in_quotes = !in_quotes;
-      pop_back_MPStrBuilder(&bld);
+      ++p;
       break;
 
     case '$':                 // Try to dereference environment variables
-      if (!in_quotes && __is_first_identifier_char(str[i + 1]))
-        __interpret_deref(&bld, str, &i);
-      break;
+      if (!in_quotes && __is_first_identifier_char(p[1])) {
+        const char* id = p + 1;
+        size_t id_len = 1;
 
-    default:
+        while (__is_identifier_char(id[id_len]))
+          ++id_len;
+
+        p = id + id_len;
+
+        // Look the name up where it lies in str
+        const char* env_var = lookup_env_n(id, id_len);
+
+        if (env_var != NULL) {
+          size_t val_len = strlen(env_var);
+          size_t need = n + val_len + (len - (p - str)) + 1;
+
+          if (need > cap) {
+            cap = 2 * need;
+            char* bigger = memory_pool_alloc(cap);
+            memcpy(bigger, out, n);
+            out = bigger;
+          }
+
+          memcpy(out + n, env_var, val_len);
+          n += val_len;
+        }
+      }
+      else {
+        out[n++] = *p++;
+      }
       break;
     }
+
+    // Copy the run of ordinary characters up to the next special one
+    size_t run = strcspn(p, in_quotes ? "\\'" : "\\'$");
+    memcpy(out + n, p, run);
+    n += run;
+    p += run;
   }
 
   // Add a null terminator
-  update_back_MPStrBuilder(&bld, '\0');
+  out[n] = '\0';
 
   assert(!in_quotes);
 
-  return as_array_MPStrBuilder(&bld, NULL);
+  return out;
 }
 
 // Build a Redirect structure
@@ -299,16 +343,82 @@ CommandHolder* parse(QuashState* state) {
 
   yyparse(&holders);
 
-  if (holders != NULL) {
-    CmdStrs strs = new_CmdStrs(10);
-    __stringify_script(holders, &strs);
-    state->parsed_str = __condense_string_array(as_array_CmdStrs(&strs, NULL));
-  }
+  // The string form is only needed for background jobs, so it is built on
+  // demand by stringify_script()
+  state->parsed_cmds = holders;
 
   return holders;
 }
 
+// Build a string from a parsed command
+char* stringify_script(const CommandHolder* holders) {
+  assert(holders != NULL);
+
+  // Everything but the result is scratch space
+  MemoryPoolMark scratch = memory_pool_mark();
+
+  CmdStrs strs = new_CmdStrs(10);
+  __stringify_script(holders, &strs);
+  char* ret = strdup(__condense_string_array(as_array_CmdStrs(&strs, NULL)));
+
+  memory_pool_release(scratch);
+
+  return ret;
+}
+
+// Scan a script file in place rather than reading standard input
+bool scan_script_file(const char* path) {
+  assert(path != NULL);
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    int err = errno;
+    close(fd);
+    errno = err;
+    return false;
+  }
+
+  // The scanner needs the buffer to end with two NUL bytes. Reserve zeroed
+  // pages one byte longer than that and map the file over the front of them;
+  // the rest of the file's last page reads as zeros too. The mapping is
+  // private and writable since the scanner briefly writes into its buffer.
+  size_t size = st.st_size;
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t len = (size + 2 + page - 1) / page * page;
+
+  char* map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map != MAP_FAILED && size > 0 &&
+      mmap(map, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    int err = errno;
+    munmap(map, len);
+    errno = err;
+    map = MAP_FAILED;
+  }
+
+  int err = errno;
+  close(fd);
+
+  if (map == MAP_FAILED) {
+    errno = err;
+    return false;
+  }
+
+  script_map = map;
+  script_map_len = len;
+  yy_scan_buffer(script_map, size + 2);
+
+  return true;
+}
+
 // Clean up dynamically allocated memory in the parser
 void destroy_parser() {
   destroy_lex();
+
+  if (script_map != NULL)
+    munmap(script_map, script_map_len);
+  script_map = NULL;
 }
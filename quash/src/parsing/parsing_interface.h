@@ -76,7 +76,8 @@ Redirect mk_redirect(char* in, char* out, bool append);
  *
  * @param str The string to clean up
  *
- * @return The cleaned up and expanded string allocated on the @a MemoryPool
+ * @return The cleaned up and expanded string allocated on the @a MemoryPool.
+ * If str needs no clean up it is returned as is.
  *
  * @sa MemoryPool
  */
@@ -87,18 +88,42 @@ char* interpret_complex_string_token(const char* str);
  * Functions used by the parser
  *************************************************************/
 /**
- * @brief Handles the call to the parser and provides a string equivalent of the
- * @a Command structure to @a QuashState
+ * @brief Handles the call to the parser and records the parsed @a Command
+ * structure in @a QuashState
  *
- * @param[out] state The state of the quash shell. The parsed_str member of
- * QuashState is set to the stringified command structure.
+ * @param[out] state The state of the quash shell. The parsed_cmds member of
+ * QuashState is set to the parsed command structure.
  *
  * @return A pointer to the parsed command structure
  *
- * @sa CommandHolder, QuashState
+ * @sa CommandHolder, QuashState, stringify_script()
  */
 CommandHolder* parse(QuashState* state);
 
+/**
+ * @brief Build a string equivalent of a parsed command structure
+ *
+ * @note The free function must be called on the result eventually
+ *
+ * @param holders The command structure returned by parse()
+ *
+ * @return A malloc'd string approximating what was typed for the command
+ */
+char* stringify_script(const CommandHolder* holders);
+
+/**
+ * @brief Make the parser read commands from a script file instead of standard
+ * input
+ *
+ * The file is memory mapped and scanned in place, so the scanner never has to
+ * read or copy it.
+ *
+ * @param path Path of the script file
+ *
+ * @return True on success. On failure false is returned and errno is set.
+ */
+bool scan_script_file(const char* path);
+
 /**
  * @brief Cleanup memory dynamically allocated by the parser
  */
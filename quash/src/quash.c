@@ -9,7 +9,9 @@
  **************************************************************************/
 #include "quash.h"
 
+#include <errno.h>
 #include <limits.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
@@ -76,6 +78,33 @@ static void print_prompt() {
     free(cwd);
 }
 
+// Wait for more input on the command line, reporting background jobs as soon
+// as they complete rather than at the next command
+static void wait_for_input() {
+  struct pollfd fds[2] = {
+    { STDIN_FILENO, POLLIN, 0 },
+    { job_event_fd(), POLLIN, 0 }
+  };
+
+  while (true) {
+    if (poll(fds, 2, -1) == -1) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+
+    if ((fds[1].revents & POLLIN) && reap_jobs_bg() > 0) {
+      // Put the messages on their own lines and show the prompt again
+      printf("\n");
+      check_jobs_bg_status();
+      print_prompt();
+    }
+
+    if (fds[0].revents)
+      return;
+  }
+}
+
 /**************************************************************************
  * Public Functions
  **************************************************************************/
@@ -86,7 +115,7 @@ bool is_running() {
 
 // Get a copy of the string
 char* get_command_string() {
-  return strdup(state.parsed_str);
+  return stringify_script(state.parsed_cmds);
 }
 
 // Check if Quash is receiving input from the command line or not
@@ -115,7 +144,24 @@ void end_main_loop() {
 int main(int argc, char** argv) {
   state = initial_state();
 
+  // Run a script file given on the command line instead of reading stdin
+  if (argc > 1) {
+    if (!scan_script_file(argv[1])) {
+      fprintf(stderr, "ERROR: Failed to open script %s: %s\n", argv[1], strerror(errno));
+      return EXIT_FAILURE;
+    }
+
+    state.is_a_tty = false;
+  }
+
   if (is_tty()) {
+    // Leave nothing buffered in stdio so poll() on stdin sees every line not
+    // yet read. The scanner reads a terminal one line at a time anyway.
+    setvbuf(stdin, NULL, _IONBF, 0);
+
+    // Run jobs in process groups of their own and hand them the terminal
+    init_job_control();
+
     puts("Welcome to Quash!");
     puts("Type \"exit\" or \"quit\" to quit");
     puts("---------------------------------");
@@ -125,18 +171,24 @@ int main(int argc, char** argv) {
   atexit(destroy_parser);
   atexit(destroy_memory_pool);
 
+  // The memory pool lives as long as quash and is reset after every command
+  initialize_memory_pool(1024);
+
   // Main execution loop
   while (is_running()) {
-    if (is_tty())
+    if (is_tty()) {
+      // Report jobs that completed while the last command ran
+      check_jobs_bg_status();
       print_prompt();
+      wait_for_input();
+    }
 
-    initialize_memory_pool(1024);
     CommandHolder* script = parse(&state);
 
     if (script != NULL)
       run_script(script);
 
-    destroy_memory_pool();
+    memory_pool_reset();
   }
 
   return EXIT_SUCCESS;
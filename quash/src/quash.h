@@ -20,8 +20,8 @@ typedef struct QuashState {
   bool running;     /**< Indicates if Quash should keep accept more input */
   bool is_a_tty;    /**< Indicates if the shell is receiving input from a file
                      * or the command line */
-  char* parsed_str; /**< Holds a string representing the parsed structure of the
-                     * command input from the command line */
+  CommandHolder* parsed_cmds; /**< Holds the parsed structure of the command
+                               * input from the command line */
 } QuashState;
 
 /**
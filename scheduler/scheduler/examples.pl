@@ -6,13 +6,22 @@
 for $file (<examples/*>){
 	if( $file =~ /proc(\d+)-c(\d+)-(\w+)\.out/){
 	#	print "Proc $1 CORE $2 Proc $3\n";
-		`./simulator -c $2 -s $3 examples/proc$1.csv | tail -7 > output1`;
-		`tail -7 $file > output2`;
+		`./simulator -c $2 -s $3 examples/proc$1.csv > output1`;
+		`cp $file output2`;
+		# The provided examples list the queue in the reference solution's own
+		# format, so only their queue lines are left out of the comparison.
+		# Every other line, and all of any other example, must match.
+		if(!`grep -l 'REMAINING:' $file`){
+			`grep -v '^  Queue:' output1 > output1.tmp; mv output1.tmp output1`;
+			`grep -v '^  Queue:' output2 > output2.tmp; mv output2.tmp output2`;
+		}
 		$diff = `diff output1 output2`;
 		if($diff){
 			print "Test file $file differs\n$diff";
+			$failed = 1;
 		}
 	}
 }
 #cleanup
 `rm output1 output2`;
+exit($failed ? 1 : 0);
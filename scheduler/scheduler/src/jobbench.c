@@ -0,0 +1,160 @@
+/** @file jobbench.c
+ *
+ * Measures the two job layouts libscheduler has used on the operation that
+ * dominates large simulations: walks of the job queue looking for a job
+ * without a core.
+ *
+ *   pointer  one record per job, queued through node_t->data, the layout the
+ *            library used before the job table
+ *   table    one array per field indexed by 32-bit slot, queued by index
+ *
+ * Both layouts reach their jobs in the same shuffled order, as a long run of
+ * arrivals and completions leaves them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "libpriqueue/libpriqueue.h"
+
+
+/*
+ * Pointer layout, field for field the record the library allocated
+ */
+typedef struct _ptr_job_t
+{
+	int t_arrival, t_total, t_remaining;
+	int t_waiting, t_updated, t_started, t_end;
+	int job_id, priority, j_core;
+	int tickets, deadline, period;
+	long key;
+	node_t node;
+	struct _ptr_job_t *next_free;
+} ptr_job_t;
+
+/*
+ * Table layout, only the columns the measured walk reads
+ */
+typedef struct _table_t
+{
+	int *j_core;
+	int *t_remaining;
+	uint32_t *next;
+} table_t;
+
+unsigned long long rng_state = 1;
+
+unsigned int rng_next(unsigned int bound)
+{
+	unsigned long long z = (rng_state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return (unsigned int)((z ^ (z >> 31)) % bound);
+}
+
+double seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void report(const char *test, const char *layout, double elapsed, double ops)
+{
+	printf("%-6s %-8s %8.3f s  %8.2f Mops/s\n", test, layout, elapsed, ops / elapsed / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+	int n = argc > 1 ? atoi(argv[1]) : 1000000;
+	int rounds = argc > 2 ? atoi(argv[2]) : 20;
+	int i, r;
+	double start, t_ptr, t_table;
+	long check_ptr = 0, check_table = 0;
+
+	if (n < 2)
+	{
+		fprintf(stderr, "Usage: %s [jobs] [queue walks]\n", argv[0]);
+		return 1;
+	}
+
+	// Jobs reach their storage in a shuffled order
+	uint32_t *order = malloc(n * sizeof(uint32_t));
+	for (i = 0; i < n; i++)
+		order[i] = i;
+	for (i = n - 1; i > 0; i--)
+	{
+		uint32_t j = rng_next(i + 1), swap = order[i];
+		order[i] = order[j];
+		order[j] = swap;
+	}
+
+	ptr_job_t *records = calloc(n, sizeof(ptr_job_t));
+	table_t t;
+	t.j_core = calloc(n, sizeof(int));
+	t.t_remaining = calloc(n, sizeof(int));
+	t.next = calloc(n, sizeof(uint32_t));
+
+	for (i = 0; i < n; i++)
+	{
+		int core = rng_next(8) == 0 ? 0 : -1;
+		int remaining = 1 + rng_next(100);
+		ptr_job_t *job = &records[order[i]];
+		job->job_id = i;
+		job->j_core = core;
+		job->t_remaining = remaining;
+		job->node.data = job;
+		t.j_core[order[i]] = core;
+		t.t_remaining[order[i]] = remaining;
+	}
+
+	printf("%d jobs, %zu byte records against %zu bytes of hot columns per job\n\n",
+			n, sizeof(ptr_job_t), 2 * sizeof(int) + sizeof(uint32_t));
+
+	/*
+	 * Queue walks: link every job in arrival order, then repeatedly look for
+	 * waiting jobs and total their remaining time, as the list schemes do when
+	 * a core frees up.
+	 */
+	for (i = 0; i < n - 1; i++)
+	{
+		records[order[i]].node.next = &records[order[i + 1]].node;
+		t.next[order[i]] = order[i + 1];
+	}
+	records[order[n - 1]].node.next = NULL;
+	t.next[order[n - 1]] = UINT32_MAX;
+
+	start = seconds();
+	for (r = 0; r < rounds; r++)
+		for (node_t *node = &records[order[0]].node; node != NULL; node = node->next)
+		{
+			ptr_job_t *job = node->data;
+			if (job->j_core == -1)
+				check_ptr += job->t_remaining;
+		}
+	t_ptr = seconds() - start;
+
+	start = seconds();
+	for (r = 0; r < rounds; r++)
+		for (uint32_t j = order[0]; j != UINT32_MAX; j = t.next[j])
+			if (t.j_core[j] == -1)
+				check_table += t.t_remaining[j];
+	t_table = seconds() - start;
+
+	report("walk", "pointer", t_ptr, (double)n * rounds);
+	report("walk", "table", t_table, (double)n * rounds);
+	printf("walk   speedup  %8.2fx\n", t_ptr / t_table);
+	if (check_ptr != check_table)
+	{
+		fprintf(stderr, "Queue walk results differ between layouts.\n");
+		return 2;
+	}
+
+	free(order);
+	free(records);
+	free(t.j_core);
+	free(t.t_remaining);
+	free(t.next);
+	return 0;
+}
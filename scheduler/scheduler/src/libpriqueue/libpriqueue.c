@@ -297,3 +297,225 @@ void priqueue_destroy(priqueue_t *q)
     priqueue_poll(q);
   }
 }
+
+/**
+  Initializes the idxheap_t data structure.
+
+  @param h a pointer to an instance of the idxheap_t data structure
+  @param comparer a function that compares the elements at two indices, given ctx as its third argument.
+  @param ctx pointer handed to every call of comparer
+ */
+void idxheap_init(idxheap_t *h, int (*comparer)(uint32_t, uint32_t, void *), void *ctx)
+{
+  h->size = 0;
+  h->capacity = 0;
+  h->data = NULL;
+  h->comp = comparer;
+  h->ctx = ctx;
+}
+
+//move the index at position up until its parent is not greater
+static void idx_sift_up(idxheap_t *h, int position)
+{
+  uint32_t item = h->data[position];
+  while (position > 0)
+  {
+    int parent = (position - 1) / 2;
+    if (h->comp(item, h->data[parent], h->ctx) >= 0)
+    {
+      break;
+    }
+    h->data[position] = h->data[parent];
+    position = parent;
+  }
+  h->data[position] = item;
+}
+
+//move the index at position down until neither child is smaller
+static void idx_sift_down(idxheap_t *h, int position)
+{
+  uint32_t item = h->data[position];
+  while (1)
+  {
+    int child = 2 * position + 1;
+    if (child >= h->size)
+    {
+      break;
+    }
+    //pick the smaller child
+    if (child + 1 < h->size && h->comp(h->data[child + 1], h->data[child], h->ctx) < 0)
+    {
+      child++;
+    }
+    if (h->comp(h->data[child], item, h->ctx) >= 0)
+    {
+      break;
+    }
+    h->data[position] = h->data[child];
+    position = child;
+  }
+  h->data[position] = item;
+}
+
+/**
+  Inserts an index into the heap.
+
+  @param h a pointer to an instance of the idxheap_t data structure
+  @param index the index to be inserted into the heap
+  @return the number of elements in the heap after insertion
+  @return -1 if the heap could not grow
+ */
+int idxheap_offer(idxheap_t *h, uint32_t index)
+{
+  //grow array by doubling
+  if (h->size == h->capacity)
+  {
+    int capacity = h->capacity == 0 ? 16 : h->capacity * 2;
+    uint32_t *data = (uint32_t *)realloc(h->data, sizeof(uint32_t) * capacity);
+    if (data == NULL)
+    {
+      return -1;
+    }
+    h->data = data;
+    h->capacity = capacity;
+  }
+
+  h->data[h->size] = index;
+  h->size++;
+  idx_sift_up(h, h->size - 1);
+  return h->size;
+}
+
+/**
+  Inserts n indices at once. When the batch is large next to the heap the
+  whole array is rebuilt bottom up in O(size), otherwise each index is
+  sifted into place.
+
+  @param h a pointer to an instance of the idxheap_t data structure
+  @param indices the indices to be inserted
+  @param n number of indices
+  @return the number of elements in the heap after insertion
+  @return -1 if the heap could not grow
+ */
+int idxheap_offer_all(idxheap_t *h, const uint32_t *indices, int n)
+{
+  if (h->size + n > h->capacity)
+  {
+    int capacity = h->capacity == 0 ? 16 : h->capacity;
+    while (capacity < h->size + n)
+    {
+      capacity *= 2;
+    }
+    uint32_t *data = (uint32_t *)realloc(h->data, sizeof(uint32_t) * capacity);
+    if (data == NULL)
+    {
+      return -1;
+    }
+    h->data = data;
+    h->capacity = capacity;
+  }
+
+  int old_size = h->size;
+  for (int i = 0; i < n; i++)
+  {
+    h->data[h->size++] = indices[i];
+  }
+
+  //n sift ups cost about n log size, a rebuild costs about 2 size
+  if (n > old_size / 4)
+  {
+    for (int i = h->size / 2 - 1; i >= 0; i--)
+    {
+      idx_sift_down(h, i);
+    }
+  }
+  else
+  {
+    for (int i = old_size; i < h->size; i++)
+    {
+      idx_sift_up(h, i);
+    }
+  }
+  return h->size;
+}
+
+/**
+  Retrieves, but does not remove, the smallest index of the heap.
+
+  @param h a pointer to an instance of the idxheap_t data structure
+  @return the smallest index
+  @return IDXHEAP_EMPTY if the heap is empty
+ */
+uint32_t idxheap_peek(idxheap_t *h)
+{
+  if (h->size == 0)
+  {
+    return IDXHEAP_EMPTY;
+  }
+  return h->data[0];
+}
+
+/**
+  Retrieves and removes the smallest index of the heap.
+
+  @param h a pointer to an instance of the idxheap_t data structure
+  @return the smallest index
+  @return IDXHEAP_EMPTY if the heap is empty
+ */
+uint32_t idxheap_poll(idxheap_t *h)
+{
+  if (h->size == 0)
+  {
+    return IDXHEAP_EMPTY;
+  }
+
+  uint32_t index = h->data[0];
+  h->size--;
+  if (h->size > 0)
+  {
+    h->data[0] = h->data[h->size];
+    idx_sift_down(h, 0);
+  }
+  return index;
+}
+
+/**
+  Returns the index stored at position of the heap array, in heap order.
+
+  @param h a pointer to an instance of the idxheap_t data structure
+  @param position position of retrieved element
+  @return the index stored at position
+  @return IDXHEAP_EMPTY if the heap does not hold that many elements
+ */
+uint32_t idxheap_at(idxheap_t *h, int position)
+{
+  if (position >= h->size || position < 0)
+  {
+    return IDXHEAP_EMPTY;
+  }
+  return h->data[position];
+}
+
+/**
+  Returns the number of elements in the heap.
+
+  @param h a pointer to an instance of the idxheap_t data structure
+  @return the number of elements in the heap
+ */
+int idxheap_size(idxheap_t *h)
+{
+  return h->size;
+}
+
+/**
+  Destroys and frees all the memory associated with h.
+
+  @param h a pointer to an instance of the idxheap_t data structure
+ */
+void idxheap_destroy(idxheap_t *h)
+{
+  free(h->data);
+  h->data = NULL;
+  h->size = 0;
+  h->capacity = 0;
+}
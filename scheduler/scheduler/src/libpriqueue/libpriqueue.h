@@ -4,6 +4,8 @@
 #ifndef LIBPRIQUEUE_H_
 #define LIBPRIQUEUE_H_
 
+#include <stdint.h>
+
 // node structure for priority queue implemented through linked list
 typedef struct _node_t
 {
@@ -36,4 +38,32 @@ int priqueue_size(priqueue_t *q);
 
 void priqueue_destroy(priqueue_t *q);
 
+/**
+  Binary min-heap of 32-bit indices, for elements kept in caller owned
+  arrays. The comparer is handed the two indices and looks up the keys
+  itself, so the heap array stays a quarter or half the size of an array
+  of pointers.
+*/
+#define IDXHEAP_EMPTY UINT32_MAX //returned by peek and poll when the heap is empty
+
+typedef struct _idxheap_t
+{
+    int size; //number of elements in the heap
+    int capacity; //number of slots allocated in data
+    uint32_t *data; //heap ordered array of indices
+    int (*comp)(uint32_t, uint32_t, void *); //pointer to comparing function
+    void *ctx; //context handed to comp
+} idxheap_t;
+
+void idxheap_init(idxheap_t *h, int (*comparer)(uint32_t, uint32_t, void *), void *ctx);
+
+int idxheap_offer(idxheap_t *h, uint32_t index);
+int idxheap_offer_all(idxheap_t *h, const uint32_t *indices, int n);
+uint32_t idxheap_peek(idxheap_t *h);
+uint32_t idxheap_poll(idxheap_t *h);
+uint32_t idxheap_at(idxheap_t *h, int position);
+int idxheap_size(idxheap_t *h);
+
+void idxheap_destroy(idxheap_t *h);
+
 #endif /* LIBPQUEUE_H_ */
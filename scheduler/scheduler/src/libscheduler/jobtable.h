@@ -0,0 +1,137 @@
+/** @file jobtable.h
+ *
+ * Job table shared by libscheduler and its benchmarks, with generators for
+ * job queue code specialized to one scheme's ordering.
+ */
+
+#ifndef JOBTABLE_H_
+#define JOBTABLE_H_
+
+#include <stdint.h>
+
+typedef uint32_t job_idx_t; //slot of a job in the job table
+#define NO_JOB UINT32_MAX   //end of a list, or an idle core
+
+/**
+  Stores information making up the jobs to be scheduled including any statistics.
+
+  One array per field, every array indexed by the same 32-bit slot. Fields read
+  by the comparers and on every call are kept apart from the bookkeeping that is
+  only touched when a job arrives, starts or finishes, so scans over the queue
+  and heap operations walk dense arrays instead of whole job records.
+*/
+typedef struct _job_table_t
+{
+  //hot
+  int *t_remaining;  //time remaining
+  int *t_total;      //total job time
+  int *priority;
+  int *t_started;    //time started
+  int *t_updated;    //last timestep where something happened
+  int *j_core;       //core job is assigned to
+  long *key;         //ready heap order: pass for STRIDE, deadline for EDF, period for RM
+  job_idx_t *next;   //next job in the job queue, or the next free slot while unused
+
+  //cold
+  int *t_arrival;    //arrival time
+  int *t_waiting;    //time spent waiting
+  int *t_end;        //time ended
+  int *job_id;       //job number
+  int *tickets;      //share of the cpu for LOTTERY and STRIDE
+  int *deadline;     //absolute deadline, -1 if the job has none
+  int *period;       //release period, 0 if the job has none
+
+  job_idx_t capacity; //slots allocated in every array
+  job_idx_t free;     //first unused slot
+} job_table_t;
+
+/**
+  @name Job queue orders
+
+  True when job j1 goes before job j2 in the job queue of a scheme. Defined
+  once here for libscheduler and for the benchmarks that measure its queue.
+  FCFS, RR and the schemes whose running jobs are held by the cores only ever
+  append, so they order by JOB_BEFORE_FIFO.
+*/
+/** @{ */
+#define JOB_BEFORE_FIFO(t, j1, j2) 0
+#define JOB_BEFORE_SJF(t, j1, j2)  ((t)->t_total[j1] < (t)->t_remaining[j2] && (t)->t_started[j2] == -1)
+#define JOB_BEFORE_PSJF(t, j1, j2) ((t)->t_remaining[j1] < (t)->t_remaining[j2])
+#define JOB_BEFORE_PRI(t, j1, j2)  ((t)->priority[j1] < (t)->priority[j2] && (t)->t_started[j2] == -1)
+#define JOB_BEFORE_PPRI(t, j1, j2) ((t)->priority[j1] < (t)->priority[j2])
+/** @} */
+
+/**
+  Job queue operations for one scheme, filled in from the functions generated
+  by IMPLEMENT_JOB_QUEUE().
+*/
+typedef struct _job_queue_ops_t
+{
+  int (*compare)(const job_table_t *t, job_idx_t j1, job_idx_t j2);
+  void (*offer)(job_table_t *t, job_idx_t *head, job_idx_t job);
+  void (*merge)(job_table_t *t, job_idx_t *head, const job_idx_t *jobs, int n);
+} job_queue_ops_t;
+
+/**
+  @def IMPLEMENT_JOB_QUEUE(name, before)
+
+  Generates the job queue functions for one ordering, with the comparison
+  written out in every loop instead of called through a pointer:
+
+    compare_name(t, j1, j2)       -1 if j1 goes before j2, 1 otherwise
+    queue_offer_name(t, head, j)  link j ahead of the first job it goes before
+    queue_merge_name(t, head, jobs, n)
+                                  link n jobs already in queue_offer order,
+                                  each lands no earlier than the one before so
+                                  one walk places them all
+
+  @param name suffix of the generated functions
+  @param before expression over t, j1 and j2, true when job j1 goes before job j2
+  @sa JOB_QUEUE_OPS()
+*/
+#define IMPLEMENT_JOB_QUEUE(name, before)                                         \
+                                                                                  \
+  static inline int compare_##name(const job_table_t *t, job_idx_t j1,            \
+                                   job_idx_t j2)                                  \
+  {                                                                               \
+    (void)t; (void)j1; (void)j2;                                                  \
+    return (before) ? -1 : 1;                                                     \
+  }                                                                               \
+                                                                                  \
+  static inline void queue_offer_##name(job_table_t *t, job_idx_t *head,          \
+                                        job_idx_t job)                            \
+  {                                                                               \
+    job_idx_t *link = head;                                                       \
+    while (*link != NO_JOB && compare_##name(t, job, *link) >= 0)                 \
+    {                                                                             \
+      link = &t->next[*link];                                                     \
+    }                                                                             \
+    t->next[job] = *link;                                                         \
+    *link = job;                                                                  \
+  }                                                                               \
+                                                                                  \
+  static inline void queue_merge_##name(job_table_t *t, job_idx_t *head,          \
+                                        const job_idx_t *jobs, int n)             \
+  {                                                                               \
+    job_idx_t *link = head;                                                       \
+    for (int i = 0; i < n; i++)                                                   \
+    {                                                                             \
+      while (*link != NO_JOB && compare_##name(t, jobs[i], *link) >= 0)           \
+      {                                                                           \
+        link = &t->next[*link];                                                   \
+      }                                                                           \
+      t->next[jobs[i]] = *link;                                                   \
+      *link = jobs[i];                                                            \
+      link = &t->next[jobs[i]];                                                   \
+    }                                                                             \
+  }
+
+/**
+  @def JOB_QUEUE_OPS(name)
+
+  A job_queue_ops_t initializer for the functions IMPLEMENT_JOB_QUEUE(name, ...)
+  generated.
+*/
+#define JOB_QUEUE_OPS(name) { &compare_##name, &queue_offer_##name, &queue_merge_##name }
+
+#endif /* JOBTABLE_H_ */
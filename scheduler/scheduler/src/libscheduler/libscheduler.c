@@ -7,79 +7,147 @@
 
 #include "libscheduler.h"
 #include "../libpriqueue/libpriqueue.h"
+#include "jobtable.h"
 
-/**
-  Stores information making up a job to be scheduled including any statistics.
+#define JOB_TABLE_SIZE 256 //slots in a new table, doubled whenever it fills
+
+typedef struct _cores_t
+{
+  job_idx_t *c_job; //array for cores, each index is core_id
+  int n_cores;      //total number of cores
+} cores_t;
 
-  You may need to define some global variables or a struct to store your job queue elements. 
+/**
+  Everything one scheduler needs, so independent instances never share state.
 */
-typedef struct _job_t
+struct _scheduler_t
 {
-  int t_arrival;   //arrival time
-  int t_total;     //total job time
-  int t_remaining; //time remaining
+  job_table_t jobs;                       //every job that arrived and has not finished
+  job_idx_t queue;                        //head of the job queue, linked through jobs.next
+  int queued;                             //length of the job queue
+  const job_queue_ops_t *ops;             //job queue order of the scheme
+  idxheap_t ready;                        //STRIDE, EDF and RM jobs waiting for a core, lowest key first
+  cores_t *c_cores;                       //struct for cores
+  scheme_t t_scheme;                      //current scheme type
+  int c_time;                             //current time
+  int n_jobs;                             //total number of jobs
+  float t_response, t_wait, t_turnaround; //scheduler performance variables
+  long global_pass;                       //STRIDE pass given to arriving jobs
+  unsigned int seed;                      //LOTTERY random state
+  job_idx_t *batch;                       //scratch for scheduler_new_jobs_r(), arrivals then jobs left waiting
+  int batch_size;                         //slots allocated in batch
+  job_idx_t *sorting;                     //jobs batch_order is ordering
+  idxheap_t batch_order;                  //positions in sorting, in the order the job queue takes them
+};
 
-  int t_waiting; //time spent waiting
-  int t_updated;  //last timestep where something happened
-  int t_started; //time started
-  int t_end; //time ended
+#define STRIDE1 (1 << 20) //stride of a job holding a single ticket
+#define NO_KEY  0x7fffffffL //heap key of an EDF or RM job without a deadline or period
 
-  int job_id; //job number
-  int priority;
-  int j_core; //core job is assigned to 
+//schemes whose running jobs are held by the cores alone instead of the job queue
+#define CORE_HELD(s) ((s)->t_scheme >= LOTTERY)
 
-} job_t;
+//job queue orders, FCFS, RR and LOTTERY only ever append
+IMPLEMENT_JOB_QUEUE(fifo, JOB_BEFORE_FIFO(t, j1, j2))
+IMPLEMENT_JOB_QUEUE(sjf,  JOB_BEFORE_SJF(t, j1, j2))
+IMPLEMENT_JOB_QUEUE(psjf, JOB_BEFORE_PSJF(t, j1, j2))
+IMPLEMENT_JOB_QUEUE(pri,  JOB_BEFORE_PRI(t, j1, j2))
+IMPLEMENT_JOB_QUEUE(ppri, JOB_BEFORE_PPRI(t, j1, j2))
 
-typedef struct _cores_t
+static const job_queue_ops_t queue_ops[] =
 {
-  job_t **c_job; //array for cores, each index is core_id
-  int n_cores;   //total number of cores
-} cores_t;
+  [FCFS] = JOB_QUEUE_OPS(fifo),
+  [SJF] = JOB_QUEUE_OPS(sjf),
+  [PSJF] = JOB_QUEUE_OPS(psjf),
+  [PRI] = JOB_QUEUE_OPS(pri),
+  [PPRI] = JOB_QUEUE_OPS(ppri),
+  [RR] = JOB_QUEUE_OPS(fifo),
+  [LOTTERY] = JOB_QUEUE_OPS(fifo),
+  [STRIDE] = JOB_QUEUE_OPS(fifo),
+  [EDF] = JOB_QUEUE_OPS(fifo),
+  [RM] = JOB_QUEUE_OPS(fifo),
+};
+
+static job_idx_t job_alloc(scheduler_t *s);
+static void job_free(scheduler_t *s, job_idx_t job);
+static job_idx_t job_arrive(scheduler_t *s, int job_number, int time, int running_time, int priority, int deadline, int period);
+static void queue_offer(scheduler_t *s, job_idx_t job);
+static void queue_offer_batch(scheduler_t *s, job_idx_t *jobs, int n);
+static void queue_remove(scheduler_t *s, job_idx_t job);
+static int queue_new_job(scheduler_t *s, job_idx_t job);
+static int core_new_job(scheduler_t *s, job_idx_t job, job_idx_t *wait, int *waiting);
+static int core_next_job(scheduler_t *s, int core_id);
+static int key_comparer(uint32_t j1, uint32_t j2, void *ctx);
+static int batch_comparer(uint32_t p1, uint32_t p2, void *ctx);
 
-priqueue_t *jobs;                       //queue for jobs
-cores_t *c_cores;                       //struct for cores
-scheme_t t_scheme;                      //current scheme type
-int c_time;                             //current time
-int n_jobs;                             //total number of jobs
-float t_response, t_wait, t_turnaround; //scheduler performance variables
+static scheduler_t *g_scheduler; //instance behind the single instance interface
 
 /**
-  Initalizes the scheduler.
- 
+  Creates a scheduler instance.
+
   Assumptions:
-    - You may assume this will be the first scheduler function called.
-    - You may assume this function will be called only once.
     - You may assume that cores is a positive, non-zero number.
     - You may assume that scheme is a valid scheduling scheme.
 
   @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
   @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
+  @return a new scheduler, released with scheduler_destroy()
 */
-void scheduler_start_up(int cores, scheme_t scheme)
+scheduler_t *scheduler_create(int cores, scheme_t scheme)
 {
-  //create structs
-  c_cores = (cores_t *)malloc(sizeof(cores_t));
-  jobs = (priqueue_t *)malloc(sizeof(priqueue_t));
-  priqueue_init(jobs, &comparer);
+  scheduler_t *s = (scheduler_t *)malloc(sizeof(scheduler_t));
+
+  //create structs, the job table is allocated by the first arrival
+  memset(&s->jobs, 0, sizeof(job_table_t));
+  s->jobs.free = NO_JOB;
+  s->queue = NO_JOB;
+  s->queued = 0;
+  s->c_cores = (cores_t *)malloc(sizeof(cores_t));
+  idxheap_init(&s->ready, &key_comparer, s);
 
   //set amount of cores
-  c_cores->n_cores = cores;
-  c_cores->c_job = (job_t **)malloc(sizeof(job_t *) * cores);
+  s->c_cores->n_cores = cores;
+  s->c_cores->c_job = (job_idx_t *)malloc(sizeof(job_idx_t) * cores);
   for (int i = 0; i < cores; i++)
   {
-    c_cores->c_job[i] = NULL;
+    s->c_cores->c_job[i] = NO_JOB;
   }
 
-  t_scheme = scheme;
-  c_time = 0;
-  t_response = 0.0;
-  t_wait = 0.0;
-  t_turnaround = 0.0;
+  s->t_scheme = scheme;
+  s->ops = &queue_ops[scheme];
+  s->c_time = 0;
+  s->n_jobs = 0;
+  s->t_response = 0.0;
+  s->t_wait = 0.0;
+  s->t_turnaround = 0.0;
+  s->global_pass = 0;
+  s->seed = 1;
+  s->batch = NULL;
+  s->batch_size = 0;
+  s->sorting = NULL;
+  idxheap_init(&s->batch_order, &batch_comparer, s);
+  return s;
+}
+
+/**
+  Initalizes the scheduler.
+
+  Assumptions:
+    - You may assume this will be the first scheduler function called.
+    - You may assume this function will be called only once.
+    - You may assume that cores is a positive, non-zero number.
+    - You may assume that scheme is a valid scheduling scheme.
+
+  @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
+  @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
+*/
+void scheduler_start_up(int cores, scheme_t scheme)
+{
+  g_scheduler = scheduler_create(cores, scheme);
 }
 
 /**
   Called when a new job arrives.
- 
+
   If multiple cores are idle, the job should be assigned to the core with the
   lowest id.
   If the job arriving should be scheduled to run during the next
@@ -89,36 +157,149 @@ void scheduler_start_up(int cores, scheme_t scheme)
   Assumptions:
     - You may assume that every job wil have a unique arrival time.
 
+  @param s the scheduler instance
   @param job_number a globally unique identification number of the job arriving.
   @param time the current time of the simulator.
   @param running_time the total number of time units this job will run before it will be finished.
   @param priority the priority of the job. (The lower the value, the higher the priority.)
   @return index of core job should be scheduled on
-  @return -1 if no scheduling changes should be made. 
- 
+  @return -1 if no scheduling changes should be made.
+
  */
-int scheduler_new_job(int job_number, int time, int running_time, int priority)
+int scheduler_new_job_r(scheduler_t *s, int job_number, int time, int running_time, int priority)
 {
-  //set new job properties
-  job_t *job = (job_t *)malloc(sizeof(job_t));
-  job->t_total = running_time;
-  job->t_remaining = running_time;
-  job->t_arrival = time;
-  job->job_id = job_number;
-  job->priority = priority;
-  job->t_started = -1;
-  job->t_updated = -1;
-  job->j_core = -1;
-
-  c_time = time;
-  n_jobs++;
+  return scheduler_new_rt_job_r(s, job_number, time, running_time, priority, 0, 0);
+}
+
+/**
+  Called when a new job with timing constraints arrives. Behaves as
+  scheduler_new_job_r(); EDF orders jobs by absolute deadline and RM by period.
+
+  @param s the scheduler instance
+  @param job_number a globally unique identification number of the job arriving.
+  @param time the current time of the simulator.
+  @param running_time the total number of time units this job will run before it will be finished.
+  @param priority the priority of the job. (The lower the value, the higher the priority.)
+  @param deadline time units after arrival the job must finish by, 0 if it has no deadline.
+  @param period release period of the task the job belongs to, 0 if it is not periodic.
+  @return index of core job should be scheduled on
+  @return -1 if no scheduling changes should be made.
+ */
+int scheduler_new_rt_job_r(scheduler_t *s, int job_number, int time, int running_time, int priority, int deadline, int period)
+{
+  job_idx_t job = job_arrive(s, job_number, time, running_time, priority, deadline, period);
 
   //increment time
-  increment_timestep();
+  increment_timestep(s);
+
+  if (CORE_HELD(s))
+  {
+    return core_new_job(s, job, NULL, NULL);
+  }
+  return queue_new_job(s, job);
+}
+
+/**
+  Called when several jobs arrive at the same time. The result is the same as
+  calling scheduler_new_rt_job_r() for each job in array order, but the cores
+  are brought up to date once, and jobs that only wait are ordered together and
+  merged into the job queue or ready heap in one pass.
+
+  @param s the scheduler instance
+  @param jobs the arriving jobs, in the order they would have been offered one at a time. Each core_id is set by the call.
+  @param n number of arriving jobs
+  @param time the current time of the simulator.
+  @return the number of arriving jobs running on a core once the whole batch is placed
+ */
+int scheduler_new_jobs_r(scheduler_t *s, scheduler_arrival_t *jobs, int n, int time)
+{
+  int i;
+  if (n <= 0)
+  {
+    return 0;
+  }
+
+  //room for the arrivals, every job left waiting and the positions being sorted
+  if (s->batch_size < 3 * n)
+  {
+    s->batch_size = 3 * n;
+    s->batch = (job_idx_t *)realloc(s->batch, sizeof(job_idx_t) * s->batch_size);
+  }
+  job_idx_t *arrived = s->batch;
+  job_idx_t *wait = s->batch + n;
+  int waiting = 0;
+
+  for (i = 0; i < n; i++)
+  {
+    arrived[i] = job_arrive(s, jobs[i].job_number, time, jobs[i].running_time, jobs[i].priority, jobs[i].deadline, jobs[i].period);
+  }
+
+  //increment time, once for the whole batch
+  increment_timestep(s);
+
+  if (CORE_HELD(s))
+  {
+    for (i = 0; i < n; i++)
+    {
+      core_new_job(s, arrived[i], wait, &waiting);
+    }
+    if (s->t_scheme == LOTTERY)
+    {
+      queue_offer_batch(s, wait, waiting);
+    }
+    else
+    {
+      idxheap_offer_all(&s->ready, wait, waiting);
+    }
+  }
+  else if (s->t_scheme == PSJF || s->t_scheme == PPRI)
+  {
+    //every arrival may preempt, and a preempted job is requeued before the next arrival is placed
+    for (i = 0; i < n; i++)
+    {
+      queue_new_job(s, arrived[i]);
+    }
+  }
+  else
+  {
+    //idle cores go to the first arrivals, the rest wait without preempting anyone
+    int idle = 0;
+    for (i = 0; i < s->c_cores->n_cores; i++)
+    {
+      if (s->c_cores->c_job[i] == NO_JOB)
+      {
+        idle++;
+      }
+    }
+    for (i = 0; i < n && i < idle; i++)
+    {
+      queue_new_job(s, arrived[i]);
+    }
+    queue_offer_batch(s, arrived + i, n - i);
+  }
+
+  int running = 0;
+  for (i = 0; i < n; i++)
+  {
+    jobs[i].core_id = s->jobs.j_core[arrived[i]];
+    if (jobs[i].core_id != -1)
+    {
+      running++;
+    }
+  }
+  return running;
+}
+
+//place a new job for the schemes that keep every job in the job queue: take the
+//lowest idle core, otherwise PSJF and PPRI may preempt a running job
+static int queue_new_job(scheduler_t *s, job_idx_t job)
+{
+  job_table_t *t = &s->jobs;
+  job_idx_t *c_job = s->c_cores->c_job;
 
   //check for free core
   int i = 0;
-  while (i < c_cores->n_cores && c_cores->c_job[i] != NULL)
+  while (i < s->c_cores->n_cores && c_job[i] != NO_JOB)
   {
     i++;
   }
@@ -127,51 +308,51 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
   int coretochange = -1;
   int corejoblength = -1;
   int corepriority = -1;
-  if (i < c_cores->n_cores) // free core
-  {
-    job->t_waiting = 0;      //arrived and started
-    job->t_started = c_time; //started now
-    job->t_updated = c_time; //updated now
-    job->j_core = i;           //what core
-    c_cores->c_job[i] = job;   //core occupied
-    priqueue_offer(jobs, job); //job in queue
+  if (i < s->c_cores->n_cores) // free core
+  {
+    t->t_waiting[job] = 0;        //arrived and started
+    t->t_started[job] = s->c_time; //started now
+    t->t_updated[job] = s->c_time; //updated now
+    t->j_core[job] = i;           //what core
+    c_job[i] = job;               //core occupied
+    queue_offer(s, job);          //job in queue
     return i;
   }
   else // all cores busy, if preemptive then switch jobs on core PSJF, PPRI
   {
     i = 0;
-    if (t_scheme == PSJF)
+    if (s->t_scheme == PSJF)
     {
-      while (i < c_cores->n_cores)
+      while (i < s->c_cores->n_cores)
       {
-        if (c_cores->c_job[i]->t_remaining > job->t_remaining)
+        if (t->t_remaining[c_job[i]] > t->t_remaining[job])
         {
           //switch
-          if (c_cores->c_job[i]->t_remaining > corejoblength) //max job length to switch
+          if (t->t_remaining[c_job[i]] > corejoblength) //max job length to switch
           {
             coretochange = i;
-            corejoblength = c_cores->c_job[i]->t_remaining;
+            corejoblength = t->t_remaining[c_job[i]];
           }
         }
         i++;
       }
     }
-    else if (t_scheme == PPRI)
+    else if (s->t_scheme == PPRI)
     {
-      while (i < c_cores->n_cores)
+      while (i < s->c_cores->n_cores)
       {
-        if (c_cores->c_job[i]->priority > job->priority)
+        if (t->priority[c_job[i]] > t->priority[job])
         {
           //switch
-          if (c_cores->c_job[i]->priority > corepriority) //max priority to switch
+          if (t->priority[c_job[i]] > corepriority) //max priority to switch
           {
             coretochange = i;
-            corepriority = c_cores->c_job[i]->priority;
+            corepriority = t->priority[c_job[i]];
           }
           // test 3 doesn't follow its own rules to use lowest core, bases it on arrival time if same higher priority
-          else if (c_cores->c_job[i]->priority == corepriority) //same max priority, later arrival is switched
+          else if (t->priority[c_job[i]] == corepriority) //same max priority, later arrival is switched
           {
-            if (c_cores->c_job[i]->t_arrival > c_cores->c_job[coretochange]->t_arrival) //same priority on higher core has later arrival time
+            if (t->t_arrival[c_job[i]] > t->t_arrival[c_job[coretochange]]) //same priority on higher core has later arrival time
             {
               coretochange = i;
             }
@@ -184,230 +365,235 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
     //preemptively slots to core over job
     if (coretochange != -1)
     {
-      job->t_waiting = 0;
-      job->t_started = c_time;
-      job->t_updated = c_time;
-      job->j_core = coretochange;
+      job_idx_t preempted = c_job[coretochange];
+
+      t->t_waiting[job] = 0;
+      t->t_started[job] = s->c_time;
+      t->t_updated[job] = s->c_time;
+      t->j_core[job] = coretochange;
 
-      c_cores->c_job[coretochange]->j_core = -1;
-      c_cores->c_job[coretochange]->t_updated = c_time;
+      t->j_core[preempted] = -1;
+      t->t_updated[preempted] = s->c_time;
 
       //if this job was started this timestep but then overwritten by this new job, it didn't actually start
-      if (c_cores->c_job[coretochange]->t_started == c_time)
+      if (t->t_started[preempted] == s->c_time)
+      {
+        t->t_started[preempted] = -1;
+        t->t_updated[preempted] = -1;
+      }
+
+      //its place in line was taken when it arrived, requeue it by the time it has left
+      if (s->t_scheme == PSJF)
       {
-        c_cores->c_job[coretochange]->t_started = -1;
-        c_cores->c_job[coretochange]->t_updated = -1;
+        queue_remove(s, preempted);
+        queue_offer(s, preempted);
       }
 
       //assign it new job
-      c_cores->c_job[coretochange] = job;
+      c_job[coretochange] = job;
 
-      priqueue_offer(jobs, job);
+      queue_offer(s, job);
       return coretochange;
     }
   }
 
   //no free cores and not preemptive
-  priqueue_offer(jobs, job);
+  queue_offer(s, job);
   return -1;
 }
 
 /**
   Called when a job has completed execution.
- 
+
   The core_id, job_number and time parameters are provided for convenience. You may be able to calculate the values with your own data structure.
   If any job should be scheduled to run on the core free'd up by the
   finished job, return the job_number of the job that should be scheduled to
   run on core core_id.
- 
+
+  @param s the scheduler instance
   @param core_id the zero-based index of the core where the job was located.
   @param job_number a globally unique identification number of the job.
   @param time the current time of the simulator.
   @return job_number of the job that should be scheduled to run on core core_id
   @return -1 if core should remain idle.
  */
-int scheduler_job_finished(int core_id, int job_number, int time)
+int scheduler_job_finished_r(scheduler_t *s, int core_id, int job_number, int time)
 {
-  c_time = time;
+  job_table_t *t = &s->jobs;
+
+  s->c_time = time;
 
   //increment time
-  increment_timestep();
+  increment_timestep(s);
+
+  if (CORE_HELD(s))
+  {
+    job_idx_t job_done = s->c_cores->c_job[core_id];
+    t->t_end[job_done] = time;
+    s->t_turnaround += (float)t->t_end[job_done] - t->t_arrival[job_done];
+    s->t_wait += (float)t->t_waiting[job_done];
+    s->t_response += (float)t->t_started[job_done] - t->t_arrival[job_done];
+    job_free(s, job_done);
+    s->c_cores->c_job[core_id] = NO_JOB;
+    return core_next_job(s, core_id);
+  }
 
   //search through queue for job being finished
-  int i = 0;
-  job_t *job_finished;
-  while (i < priqueue_size(jobs))
+  job_idx_t job_finished = s->queue;
+  while (job_finished != NO_JOB && t->job_id[job_finished] != job_number)
   {
-    job_finished = priqueue_at(jobs, i);
-    if (job_finished->job_id == job_number)
-    {
-      //if this job ended, remove from queue
-      job_finished = priqueue_remove_at(jobs, i);
-      break;
-    }
-    i++;
+    job_finished = t->next[job_finished];
   }
 
+  //if this job ended, remove from queue
+  queue_remove(s, job_finished);
+
   //end time
-  job_finished->t_end = time;
+  t->t_end[job_finished] = time;
 
   // stats
-  t_turnaround += (float)job_finished->t_end - job_finished->t_arrival;
-  t_wait += (float)job_finished->t_waiting;
-  t_response += (float)job_finished->t_started - job_finished->t_arrival;
+  s->t_turnaround += (float)t->t_end[job_finished] - t->t_arrival[job_finished];
+  s->t_wait += (float)t->t_waiting[job_finished];
+  s->t_response += (float)t->t_started[job_finished] - t->t_arrival[job_finished];
 
-  free(job_finished);
+  job_free(s, job_finished);
 
   // empty core slot
-  c_cores->c_job[core_id] = NULL;
+  s->c_cores->c_job[core_id] = NO_JOB;
 
-  //check if empty job queue
-  if (priqueue_size(jobs) == 0)
+  //look at next job, the first that isnt already on a core
+  job_idx_t next_job = s->queue;
+  while (next_job != NO_JOB && t->j_core[next_job] != -1)
   {
-    return -1;
-  }
-
-  //look at next job
-  i = 0;
-  job_t *next_job = NULL;
-  while (i < priqueue_size(jobs))
-  {
-    next_job = priqueue_at(jobs, i);
-    // job exists and isnt already on a core
-    if (next_job != NULL && next_job->j_core == -1)
-    {
-      break;
-    }
-    i++;
+    next_job = t->next[next_job];
   }
 
   //there is no job without a core
-  if (i >= priqueue_size(jobs))
+  if (next_job == NO_JOB)
   {
     return -1;
   }
 
-  // if there is a next job to assign to core
-  if (next_job != NULL)
+  //never started, been waiting
+  if (t->t_started[next_job] == -1)
   {
-    //never started, been waiting
-    if (next_job->t_started == -1)
-    {
-      //assign start time, add that to wait
-      next_job->t_started = c_time;
-      next_job->t_updated = c_time;
-      next_job->t_waiting = next_job->t_started - next_job->t_arrival;
-    }
-    //started then waited
-    else
-    {
-      //add time waiting in queue after already started from pause point
-      next_job->t_waiting += c_time - next_job->t_updated;
-      next_job->t_updated = c_time;
-    }
-
-    next_job->j_core = core_id;
-    c_cores->c_job[core_id] = next_job;
-    return next_job->job_id;
+    //assign start time, add that to wait
+    t->t_started[next_job] = s->c_time;
+    t->t_updated[next_job] = s->c_time;
+    t->t_waiting[next_job] = t->t_started[next_job] - t->t_arrival[next_job];
   }
+  //started then waited
   else
   {
-    return -1;
+    //add time waiting in queue after already started from pause point
+    t->t_waiting[next_job] += s->c_time - t->t_updated[next_job];
+    t->t_updated[next_job] = s->c_time;
   }
+
+  t->j_core[next_job] = core_id;
+  s->c_cores->c_job[core_id] = next_job;
+  return t->job_id[next_job];
 }
 
 /**
   When the scheme is set to RR, called when the quantum timer has expired
   on a core.
- 
+
   If any job should be scheduled to run on the core free'd up by
   the quantum expiration, return the job_number of the job that should be
   scheduled to run on core core_id.
 
+  @param s the scheduler instance
   @param core_id the zero-based index of the core where the quantum has expired.
-  @param time the current time of the simulator. 
+  @param time the current time of the simulator.
   @return job_number of the job that should be scheduled on core cord_id
   @return -1 if core should remain idle
  */
-int scheduler_quantum_expired(int core_id, int time)
+int scheduler_quantum_expired_r(scheduler_t *s, int core_id, int time)
 {
+  job_table_t *t = &s->jobs;
 
-  c_time = time;
+  s->c_time = time;
 
-  increment_timestep();
+  increment_timestep(s);
 
-  int length = priqueue_size(jobs);
-
-  //search for job in queue that is on core
-  int i = 0;
-  job_t *active_job;
-  while (i < length)
+  if (CORE_HELD(s))
   {
-    active_job = priqueue_at(jobs, i);
-    //if this job is the one on the core, remove from queue
-    if (active_job->job_id == c_cores->c_job[core_id]->job_id)
+    //charge the job for its quantum and send it back to wait
+    job_idx_t expired = s->c_cores->c_job[core_id];
+    t->j_core[expired] = -1;
+    t->t_updated[expired] = s->c_time;
+    s->c_cores->c_job[core_id] = NO_JOB;
+    if (s->t_scheme == STRIDE)
     {
-      active_job = priqueue_remove_at(jobs, i);
-      //job hasnt ended this quantum jump
-      if (active_job->t_remaining != 0)
-      {
-        //put at back of queue
-        active_job->j_core = -1;
-        active_job->t_updated = c_time;
-        priqueue_offer(jobs, active_job);
-      }
-      //job ended this jump
-      else
-      {
-        active_job->t_end = c_time;
+      t->key[expired] += STRIDE1 / t->tickets[expired];
+      idxheap_offer(&s->ready, expired);
+    }
+    else
+    {
+      queue_offer(s, expired);
+    }
+    return core_next_job(s, core_id);
+  }
 
-        //stats
-        t_turnaround += (float)active_job->t_end - active_job->t_arrival;
-        t_wait += (float)active_job->t_waiting;
-        t_response += (float)active_job->t_started - active_job->t_arrival;
+  //the job on the core leaves the queue
+  job_idx_t active_job = s->c_cores->c_job[core_id];
+  queue_remove(s, active_job);
 
-        c_cores->c_job[core_id] = NULL;
-        free(active_job);
-      }
-      break;
-    }
-    i++;
+  //job hasnt ended this quantum jump
+  if (t->t_remaining[active_job] != 0)
+  {
+    //put at back of queue
+    t->j_core[active_job] = -1;
+    t->t_updated[active_job] = s->c_time;
+    queue_offer(s, active_job);
+  }
+  //job ended this jump
+  else
+  {
+    t->t_end[active_job] = s->c_time;
+
+    //stats
+    s->t_turnaround += (float)t->t_end[active_job] - t->t_arrival[active_job];
+    s->t_wait += (float)t->t_waiting[active_job];
+    s->t_response += (float)t->t_started[active_job] - t->t_arrival[active_job];
+
+    s->c_cores->c_job[core_id] = NO_JOB;
+    job_free(s, active_job);
   }
 
-  //search for next job to put in core
-  i = 0;
-  job_t *next_job;
-  while (i < priqueue_size(jobs))
+  //search for next job to put in core, the first not on a core
+  job_idx_t next_job = s->queue;
+  while (next_job != NO_JOB && t->j_core[next_job] != -1)
   {
-    next_job = priqueue_at(jobs, i);
-    //if this job is not on a core, assign to this core
-    if (next_job->j_core == -1)
-    {
-      //assign job to core that ended
-      //never started, been waiting
-      if (next_job->t_started == -1)
-      {
-        //assign start time, add that to wait
-        next_job->t_started = c_time;
-        next_job->t_updated = c_time;
-        next_job->t_waiting = next_job->t_started - next_job->t_arrival;
-      }
-      //started then waited
-      else
-      {
-        //add time waiting in queue after already started from pause point
-        next_job->t_waiting += c_time - next_job->t_updated;
-        next_job->t_updated = c_time;
-      }
+    next_job = t->next[next_job];
+  }
 
-      next_job->j_core = core_id;
-      c_cores->c_job[core_id] = next_job;
-      return next_job->job_id;
-    }
-    i++;
+  if (next_job == NO_JOB)
+  {
+    return -1;
   }
 
-  return -1;
+  //assign job to core that ended
+  //never started, been waiting
+  if (t->t_started[next_job] == -1)
+  {
+    //assign start time, add that to wait
+    t->t_started[next_job] = s->c_time;
+    t->t_updated[next_job] = s->c_time;
+    t->t_waiting[next_job] = t->t_started[next_job] - t->t_arrival[next_job];
+  }
+  //started then waited
+  else
+  {
+    //add time waiting in queue after already started from pause point
+    t->t_waiting[next_job] += s->c_time - t->t_updated[next_job];
+    t->t_updated[next_job] = s->c_time;
+  }
+
+  t->j_core[next_job] = core_id;
+  s->c_cores->c_job[core_id] = next_job;
+  return t->job_id[next_job];
 }
 
 /**
@@ -415,13 +601,14 @@ int scheduler_quantum_expired(int core_id, int time)
 
   Assumptions:
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
+  @param s the scheduler instance
   @return the average waiting time of all jobs scheduled.
  */
-float scheduler_average_waiting_time()
+float scheduler_average_waiting_time_r(scheduler_t *s)
 {
-  if (t_wait != 0.0)
+  if (s->t_wait != 0.0)
   {
-    return ((float)t_wait / n_jobs);
+    return ((float)s->t_wait / s->n_jobs);
   }
   else
   {
@@ -434,13 +621,14 @@ float scheduler_average_waiting_time()
 
   Assumptions:
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
+  @param s the scheduler instance
   @return the average turnaround time of all jobs scheduled.
  */
-float scheduler_average_turnaround_time()
+float scheduler_average_turnaround_time_r(scheduler_t *s)
 {
-  if (t_turnaround != 0.0)
+  if (s->t_turnaround != 0.0)
   {
-    return ((float)t_turnaround / n_jobs);
+    return ((float)s->t_turnaround / s->n_jobs);
   }
   else
   {
@@ -453,13 +641,14 @@ float scheduler_average_turnaround_time()
 
   Assumptions:
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
+  @param s the scheduler instance
   @return the average response time of all jobs scheduled.
  */
-float scheduler_average_response_time()
+float scheduler_average_response_time_r(scheduler_t *s)
 {
-  if (t_response != 0.0)
+  if (s->t_response != 0.0)
   {
-    return ((float)t_response / n_jobs);
+    return ((float)s->t_response / s->n_jobs);
   }
   else
   {
@@ -467,18 +656,60 @@ float scheduler_average_response_time()
   }
 }
 
+/**
+  Frees a scheduler instance and any jobs still queued in it.
+
+  @param s the scheduler created by scheduler_create()
+*/
+void scheduler_destroy(scheduler_t *s)
+{
+  //queued and running jobs all live in the job table
+  job_table_t *t = &s->jobs;
+  idxheap_destroy(&s->ready);
+  idxheap_destroy(&s->batch_order);
+  free(s->batch);
+  free(t->t_remaining);
+  free(t->t_total);
+  free(t->priority);
+  free(t->t_started);
+  free(t->t_updated);
+  free(t->j_core);
+  free(t->key);
+  free(t->next);
+  free(t->t_arrival);
+  free(t->t_waiting);
+  free(t->t_end);
+  free(t->job_id);
+  free(t->tickets);
+  free(t->deadline);
+  free(t->period);
+  free(s->c_cores->c_job);
+  free(s->c_cores);
+  free(s);
+}
+
 /**
   Free any memory associated with your scheduler.
- 
+
   Assumptions:
     - This function will be the last function called in your library.
 */
 void scheduler_clean_up()
 {
-  priqueue_destroy(jobs);
-  free(jobs);
-  free(c_cores->c_job);
-  free(c_cores);
+  scheduler_destroy(g_scheduler);
+  g_scheduler = NULL;
+}
+
+//print a job held by a core or the ready heap, with tickets only for the schemes that have them
+static void show_held_job(scheduler_t *s, job_idx_t job)
+{
+  job_table_t *t = &s->jobs;
+  printf("%d ", t->job_id[job]);
+  if (s->t_scheme == LOTTERY || s->t_scheme == STRIDE)
+  {
+    printf("TICKETS: %d ", t->tickets[job]);
+  }
+  printf("KEY: %ld REMAINING: %d CORE: %d |", t->key[job], t->t_remaining[job], t->j_core[job]);
 }
 
 /**
@@ -487,107 +718,437 @@ void scheduler_clean_up()
   makes to your scheduler.
   In our provided output, we have implemented this function to list the jobs in the order they are to be scheduled. Furthermore, we have also listed the current state of the job (either running on a given core or idle). For example, if we have a non-preemptive algorithm and job(id=4) has began running, job(id=2) arrives with a higher priority, and job(id=1) arrives with a lower priority, the output in our sample output will be:
 
-    2(-1) 4(0) 1(-1)  
-  
+    2(-1) 4(0) 1(-1)
+
   This function is not required and will not be graded. You may leave it
   blank if you do not find it useful.
  */
+void scheduler_show_queue_r(scheduler_t *s)
+{
+  job_table_t *t = &s->jobs;
+  job_idx_t temp;
+  int i;
+  if (CORE_HELD(s))
+  {
+    //running jobs are only held by the cores
+    for (i = 0; i < s->c_cores->n_cores; i++)
+    {
+      temp = s->c_cores->c_job[i];
+      if (temp != NO_JOB)
+      {
+        show_held_job(s, temp);
+      }
+    }
+    i = 0;
+    while ((temp = idxheap_at(&s->ready, i)) != IDXHEAP_EMPTY)
+    {
+      show_held_job(s, temp);
+      i++;
+    }
+  }
+  for (temp = s->queue; temp != NO_JOB; temp = t->next[temp])
+  {
+    printf("%d PRIORITY: %d REMAINING: %d CORE: %d |", t->job_id[temp], t->priority[temp], t->t_remaining[temp], t->j_core[temp]);
+  }
+}
+
+//thin wrappers around the process wide instance
+int scheduler_new_job(int job_number, int time, int running_time, int priority)
+{
+  return scheduler_new_job_r(g_scheduler, job_number, time, running_time, priority);
+}
+
+int scheduler_new_rt_job(int job_number, int time, int running_time, int priority, int deadline, int period)
+{
+  return scheduler_new_rt_job_r(g_scheduler, job_number, time, running_time, priority, deadline, period);
+}
+
+int scheduler_new_jobs(scheduler_arrival_t *jobs, int n, int time)
+{
+  return scheduler_new_jobs_r(g_scheduler, jobs, n, time);
+}
+
+int scheduler_job_finished(int core_id, int job_number, int time)
+{
+  return scheduler_job_finished_r(g_scheduler, core_id, job_number, time);
+}
+
+int scheduler_quantum_expired(int core_id, int time)
+{
+  return scheduler_quantum_expired_r(g_scheduler, core_id, time);
+}
+
+float scheduler_average_waiting_time()
+{
+  return scheduler_average_waiting_time_r(g_scheduler);
+}
+
+float scheduler_average_turnaround_time()
+{
+  return scheduler_average_turnaround_time_r(g_scheduler);
+}
+
+float scheduler_average_response_time()
+{
+  return scheduler_average_response_time_r(g_scheduler);
+}
+
 void scheduler_show_queue()
 {
-  int length = priqueue_size(jobs);
+  scheduler_show_queue_r(g_scheduler);
+}
+
+void increment_timestep(scheduler_t *s)
+{
+  job_table_t *t = &s->jobs;
   int i = 0;
-  job_t *temp;
-  while (i < length)
+  for (i = 0; i < s->c_cores->n_cores; i++)
   {
-    temp = priqueue_at(jobs, i);
-    printf("%d PRIORITY: %d REMAINING: %d CORE: %d |", temp->job_id, temp->priority, temp->t_remaining, temp->j_core); //temp->priority);
-    i++;
+    // get job on core
+    job_idx_t running_job = s->c_cores->c_job[i];
+    // core has job running
+    if (running_job != NO_JOB)
+    {
+      //if job hasnt started and wasn't updated this timestep FCFS, SJF, PRI
+      if ((t->t_started[running_job] == -1) && (t->t_updated[running_job] != s->c_time))
+      {
+        t->t_started[running_job] = t->t_updated[running_job];
+        // t_response += (float)(running_job->t_started - running_job->t_arrival);
+      }
+      else
+      { // else job was paused or already started and restarted PSJF, PPRI
+        t->t_remaining[running_job] -= s->c_time - t->t_updated[running_job];
+        t->t_updated[running_job] = s->c_time;
+      }
+    }
   }
 }
 
-int comparer(const void *p1, const void *p2)
-{ //p1 = new node to insert p2 = node in queue
-  job_t *job_1 = (job_t *)p1;
-  job_t *job_2 = (job_t *)p2;
-  if (job_2 == NULL)
+//take a slot for an arriving job and fill it in
+static job_idx_t job_arrive(scheduler_t *s, int job_number, int time, int running_time, int priority, int deadline, int period)
+{
+  //set new job properties
+  job_idx_t job = job_alloc(s);
+  job_table_t *t = &s->jobs;
+  t->t_total[job] = running_time;
+  t->t_remaining[job] = running_time;
+  t->t_arrival[job] = time;
+  t->job_id[job] = job_number;
+  t->priority[job] = priority;
+  t->t_started[job] = -1;
+  t->t_updated[job] = -1;
+  t->t_waiting[job] = 0;
+  t->j_core[job] = -1;
+  t->tickets[job] = scheduler_tickets(priority);
+  t->deadline[job] = deadline > 0 ? time + deadline : -1;
+  t->period[job] = period > 0 ? period : 0;
+  t->key[job] = 0;
+
+  s->c_time = time;
+  s->n_jobs++;
+  return job;
+}
+
+//grow one column of the job table
+#define GROW(t, field, capacity) \
+  (t)->field = realloc((t)->field, sizeof(*(t)->field) * (capacity))
+
+//take a free slot, doubling every column of the table when none is left
+static job_idx_t job_alloc(scheduler_t *s)
+{
+  job_table_t *t = &s->jobs;
+  if (t->free == NO_JOB)
   {
-    return -1;
+    job_idx_t old = t->capacity;
+    job_idx_t capacity = old == 0 ? JOB_TABLE_SIZE : old * 2;
+    GROW(t, t_remaining, capacity);
+    GROW(t, t_total, capacity);
+    GROW(t, priority, capacity);
+    GROW(t, t_started, capacity);
+    GROW(t, t_updated, capacity);
+    GROW(t, j_core, capacity);
+    GROW(t, key, capacity);
+    GROW(t, next, capacity);
+    GROW(t, t_arrival, capacity);
+    GROW(t, t_waiting, capacity);
+    GROW(t, t_end, capacity);
+    GROW(t, job_id, capacity);
+    GROW(t, tickets, capacity);
+    GROW(t, deadline, capacity);
+    GROW(t, period, capacity);
+    for (job_idx_t i = capacity - 1; i >= old && i != NO_JOB; i--)
+    {
+      t->next[i] = t->free;
+      t->free = i;
+    }
+    t->capacity = capacity;
   }
-  switch (t_scheme)
+
+  job_idx_t job = t->free;
+  t->free = t->next[job];
+  t->next[job] = NO_JOB;
+  return job;
+}
+
+//return a finished job's slot to the free list
+static void job_free(scheduler_t *s, job_idx_t job)
+{
+  s->jobs.next[job] = s->jobs.free;
+  s->jobs.free = job;
+}
+
+//link a job into the job queue ahead of the first job it goes before
+static void queue_offer(scheduler_t *s, job_idx_t job)
+{
+  s->ops->offer(&s->jobs, &s->queue, job);
+  s->queued++;
+}
+
+//link jobs that all wait into the job queue, sorted the way queue_offer() would
+//leave them so one walk places them all
+static void queue_offer_batch(scheduler_t *s, job_idx_t *jobs, int n)
+{
+  uint32_t *positions = s->batch + 2 * (s->batch_size / 3);
+  uint32_t i;
+  int k;
+
+  //heapify positions rather than jobs so equal jobs keep their arrival order
+  for (i = 0; i < (uint32_t)n; i++)
+  {
+    positions[i] = i;
+  }
+  s->sorting = jobs;
+  idxheap_offer_all(&s->batch_order, positions, n);
+
+  //positions are no longer needed once in the heap, reuse them for the sorted jobs
+  for (k = 0; (i = idxheap_poll(&s->batch_order)) != IDXHEAP_EMPTY; k++)
+  {
+    positions[k] = jobs[i];
+  }
+  s->ops->merge(&s->jobs, &s->queue, positions, n);
+  s->queued += n;
+}
+
+//unlink a job from the job queue
+static void queue_remove(scheduler_t *s, job_idx_t job)
+{
+  job_idx_t *next = s->jobs.next;
+  job_idx_t *link = &s->queue;
+  while (*link != NO_JOB && *link != job)
+  {
+    link = &next[*link];
+  }
+  if (*link == job)
+  {
+    *link = next[job];
+    next[job] = NO_JOB;
+    s->queued--;
+  }
+}
+
+/**
+  Returns the number of lottery tickets, or stride weight, a job with the given
+  priority holds. Higher values earn a larger share; every job holds at least one.
+
+  @param priority the priority column of the job
+  @return the job's tickets
+ */
+int scheduler_tickets(int priority)
+{
+  if (priority < 1)
   {
-  case FCFS:
     return 1;
-    break;
-  case SJF:
-    if (job_1->t_total < job_2->t_remaining && job_2->t_started == -1)
-    {
-      return -1;
-    }
-    else
-    {
-      return 1;
-    }
-    break;
-  case PSJF:
-    if (job_1->t_remaining < job_2->t_remaining)
-    {
-      return -1;
-    }
-    else
-    {
-      return 1;
-    }
-    break;
-  case PRI:
-    if (job_1->priority < job_2->priority && job_2->t_started == -1)
+  }
+  return priority;
+}
+
+//order ready jobs by key, ties go to the earlier job
+static int key_comparer(uint32_t j1, uint32_t j2, void *ctx)
+{
+  job_table_t *t = &((scheduler_t *)ctx)->jobs;
+  if (t->key[j1] != t->key[j2])
+  {
+    return t->key[j1] < t->key[j2] ? -1 : 1;
+  }
+  return t->job_id[j1] - t->job_id[j2];
+}
+
+//arrival for schemes that keep running jobs on the cores: take the lowest idle
+//core, otherwise EDF and RM preempt the running job with the largest key. Jobs
+//left waiting are queued, or collected in wait when a batch queues them later
+static int core_new_job(scheduler_t *s, job_idx_t job, job_idx_t *wait, int *waiting)
+{
+  job_table_t *t = &s->jobs;
+  job_idx_t *c_job = s->c_cores->c_job;
+
+  if (s->t_scheme == STRIDE)
+  {
+    //join at the current virtual time so neither old nor new jobs are starved
+    t->key[job] = s->global_pass;
+  }
+  else if (s->t_scheme == EDF)
+  {
+    t->key[job] = t->deadline[job] != -1 ? t->deadline[job] : NO_KEY;
+  }
+  else if (s->t_scheme == RM)
+  {
+    //without a period, fall back to the relative deadline (deadline monotonic)
+    if (t->period[job] > 0)
     {
-      return -1;
+      t->key[job] = t->period[job];
     }
     else
     {
-      return 1;
+      t->key[job] = t->deadline[job] != -1 ? t->deadline[job] - t->t_arrival[job] : NO_KEY;
     }
-    break;
-  case PPRI:
-    if (job_1->priority < job_2->priority)
+  }
+
+  int i = 0;
+  while (i < s->c_cores->n_cores && c_job[i] != NO_JOB)
+  {
+    i++;
+  }
+
+  if (i < s->c_cores->n_cores)
+  {
+    t->t_waiting[job] = 0;
+    t->t_started[job] = s->c_time;
+    t->t_updated[job] = s->c_time;
+    t->j_core[job] = i;
+    c_job[i] = job;
+    return i;
+  }
+
+  if (s->t_scheme == EDF || s->t_scheme == RM)
+  {
+    //find the running job that is least urgent
+    int coretochange = 0;
+    for (i = 1; i < s->c_cores->n_cores; i++)
     {
-      return -1;
+      if (key_comparer(c_job[i], c_job[coretochange], s) > 0)
+      {
+        coretochange = i;
+      }
     }
-    else
+
+    job_idx_t preempted = c_job[coretochange];
+    if (key_comparer(job, preempted, s) < 0)
     {
-      return 1;
+      t->j_core[preempted] = -1;
+      t->t_updated[preempted] = s->c_time;
+      //if this job was started this timestep but then overwritten by this new job, it didn't actually start
+      if (t->t_started[preempted] == s->c_time)
+      {
+        t->t_started[preempted] = -1;
+        t->t_updated[preempted] = -1;
+      }
+      if (wait != NULL)
+      {
+        wait[(*waiting)++] = preempted;
+      }
+      else
+      {
+        idxheap_offer(&s->ready, preempted);
+      }
+
+      t->t_waiting[job] = 0;
+      t->t_started[job] = s->c_time;
+      t->t_updated[job] = s->c_time;
+      t->j_core[job] = coretochange;
+      c_job[coretochange] = job;
+      return coretochange;
     }
-    break;
-  case RR:
-    return 1;
-    break;
-  default:
+  }
+
+  if (wait != NULL)
+  {
+    wait[(*waiting)++] = job;
+  }
+  else if (s->t_scheme == LOTTERY)
+  {
+    queue_offer(s, job);
+  }
+  else
+  {
+    idxheap_offer(&s->ready, job);
+  }
+  return -1;
+}
+
+//order positions of a batch by where queue_offer() would put their jobs, ties by position
+static int batch_comparer(uint32_t p1, uint32_t p2, void *ctx)
+{
+  scheduler_t *s = (scheduler_t *)ctx;
+  job_idx_t j1 = s->sorting[p1];
+  job_idx_t j2 = s->sorting[p2];
+  if (s->ops->compare(&s->jobs, j1, j2) < 0)
+  {
+    return -1;
+  }
+  if (s->ops->compare(&s->jobs, j2, j1) < 0)
+  {
     return 1;
-    break;
   }
+  return p1 < p2 ? -1 : 1;
 }
 
-void increment_timestep()
+//dispatch for schemes that keep running jobs on the cores: pick the next waiting
+//job for core_id and start it there
+static int core_next_job(scheduler_t *s, int core_id)
 {
-  int i = 0;
-  for (i = 0; i < c_cores->n_cores; i++)
+  job_table_t *t = &s->jobs;
+  job_idx_t next_job = NO_JOB;
+  if (s->t_scheme != LOTTERY)
   {
-    // get job on core
-    job_t *running_job = c_cores->c_job[i];
-    // core has job running
-    if (running_job != NULL)
+    //lowest pass, deadline or period is at the top of the heap
+    next_job = idxheap_poll(&s->ready);
+  }
+  else if (s->queued > 0)
+  {
+    //draw a winning ticket among all waiting jobs
+    int total = 0;
+    job_idx_t j;
+    for (j = s->queue; j != NO_JOB; j = t->next[j])
     {
-      //if job hasnt started and wasn't updated this timestep FCFS, SJF, PRI
-      if ((running_job->t_started == -1) && (running_job->t_updated != c_time))
+      total += t->tickets[j];
+    }
+    int winner = rand_r(&s->seed) % total;
+    for (j = s->queue; j != NO_JOB; j = t->next[j])
+    {
+      next_job = j;
+      winner -= t->tickets[j];
+      if (winner < 0)
       {
-        running_job->t_started = running_job->t_updated;
-        // t_response += (float)(running_job->t_started - running_job->t_arrival);
-      }
-      else
-      { // else job was paused or already started and restarted PSJF, PPRI
-        running_job->t_remaining -= c_time - running_job->t_updated;
-        running_job->t_updated = c_time;
+        break;
       }
     }
+    queue_remove(s, next_job);
   }
-}
\ No newline at end of file
+
+  if (next_job == NO_JOB)
+  {
+    return -1;
+  }
+
+  //never started, been waiting
+  if (t->t_started[next_job] == -1)
+  {
+    t->t_started[next_job] = s->c_time;
+    t->t_updated[next_job] = s->c_time;
+    t->t_waiting[next_job] = t->t_started[next_job] - t->t_arrival[next_job];
+  }
+  //started then waited
+  else
+  {
+    t->t_waiting[next_job] += s->c_time - t->t_updated[next_job];
+    t->t_updated[next_job] = s->c_time;
+  }
+
+  if (s->t_scheme == STRIDE && t->key[next_job] > s->global_pass)
+  {
+    s->global_pass = t->key[next_job];
+  }
+  t->j_core[next_job] = core_id;
+  s->c_cores->c_job[core_id] = next_job;
+  return t->job_id[next_job];
+}
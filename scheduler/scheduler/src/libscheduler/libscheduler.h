@@ -4,14 +4,54 @@
 #ifndef LIBSCHEDULER_H_
 #define LIBSCHEDULER_H_
 
+#include <stdint.h>
+
 /**
   Constants which represent the different scheduling algorithms
 */
-typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR} scheme_t;
-//first come first serve, shortest job first, shortest remaining time, fixed priority, preemptive priority, round robin
+typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR, LOTTERY, STRIDE, EDF, RM} scheme_t;
+//first come first serve, shortest job first, shortest remaining time, fixed priority, preemptive priority, round robin,
+//lottery and stride proportional share (the priority column is read as tickets, higher gets more cpu),
+//earliest deadline first and rate monotonic (both preemptive)
+
+/**
+  A self contained scheduler. All of its state lives in the instance, so any
+  number of schedulers may run side by side in one process.
+*/
+typedef struct _scheduler_t scheduler_t;
+
+/**
+  One of several jobs arriving at the same time, handed to scheduler_new_jobs_r().
+*/
+typedef struct _scheduler_arrival_t
+{
+  int job_number;
+  int running_time;
+  int priority;
+  int deadline; //relative to arrival, 0 if none
+  int period;   //0 if none
+  int core_id;  //set by the call: the core running the job after the whole batch is placed, -1 if it waits
+} scheduler_arrival_t;
+
+scheduler_t *scheduler_create                   (int cores, scheme_t scheme);
+int          scheduler_new_job_r                (scheduler_t *s, int job_number, int time, int running_time, int priority);
+int          scheduler_new_rt_job_r             (scheduler_t *s, int job_number, int time, int running_time, int priority, int deadline, int period);
+int          scheduler_new_jobs_r               (scheduler_t *s, scheduler_arrival_t *jobs, int n, int time);
+int          scheduler_job_finished_r           (scheduler_t *s, int core_id, int job_number, int time);
+int          scheduler_quantum_expired_r        (scheduler_t *s, int core_id, int time);
+float        scheduler_average_turnaround_time_r(scheduler_t *s);
+float        scheduler_average_waiting_time_r   (scheduler_t *s);
+float        scheduler_average_response_time_r  (scheduler_t *s);
+void         scheduler_show_queue_r             (scheduler_t *s);
+void         scheduler_destroy                  (scheduler_t *s);
+
+int          scheduler_tickets                  (int priority);
 
+//single instance interface, wraps one scheduler_t shared by the whole process
 void  scheduler_start_up               (int cores, scheme_t scheme);
 int   scheduler_new_job                (int job_number, int time, int running_time, int priority);
+int   scheduler_new_rt_job             (int job_number, int time, int running_time, int priority, int deadline, int period);
+int   scheduler_new_jobs               (scheduler_arrival_t *jobs, int n, int time);
 int   scheduler_job_finished           (int core_id, int job_number, int time);
 int   scheduler_quantum_expired        (int core_id, int time);
 float scheduler_average_turnaround_time();
@@ -21,7 +61,6 @@ void  scheduler_clean_up               ();
 
 void  scheduler_show_queue             ();
 
-int comparer                            (const void* p1, const void* p2);
-void increment_timestep                  ();
+void increment_timestep                  (scheduler_t *s);
 
 #endif /* LIBSCHEDULER_H_ */
@@ -0,0 +1,482 @@
+/** @file live.c
+ *
+ * Runs a workload on real processes under the library's decisions. Every job
+ * becomes a forked worker that burns running_time time units of cpu. The
+ * driver asks the scheduler what each core should run at every time unit,
+ * pins the chosen worker to that cpu with sched_setaffinity() and enforces
+ * the assignment with SIGSTOP/SIGCONT. The same workload is simulated with a
+ * second scheduler instance, and the measured waiting, response and
+ * turnaround times are compared against those predictions.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "libscheduler/libscheduler.h"
+#include "trace/trace.h"
+
+
+typedef struct _live_job_t
+{
+	trace_record_t in;
+
+	// Predicted by the simulated instance, in time units
+	int sim_start, sim_finish;
+
+	// Live run
+	pid_t pid;
+	int arrived, exited, running, core_id;
+	int remaining;          // modeled time units still to run; 0 while overrunning
+	double t_start;         // seconds since the run started, first SIGCONT
+	double t_cpu;           // seconds of cpu the worker used, from wait4()
+} live_job_t;
+
+// Finish timestamps written by the workers themselves, shared with the driver
+double *finish_stamp;
+
+struct timespec run_epoch;
+
+double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec - run_epoch.tv_sec) + (ts.tv_nsec - run_epoch.tv_nsec) / 1e9;
+}
+
+void print_usage(char *program_name)
+{
+	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> [-u <usec per time unit>] <input file>\n", program_name);
+	fprintf(stderr, "       %s -c 2 -s rr2 -u 20000 examples/proc1.csv\n", program_name);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#, lottery#, stride#, edf, rm\n");
+}
+
+int parse_scheme(char *name, int *quantum)
+{
+	*quantum = 0;
+	if (strcasecmp(name, "FCFS") == 0) return FCFS;
+	if (strcasecmp(name, "SJF") == 0) return SJF;
+	if (strcasecmp(name, "PSJF") == 0) return PSJF;
+	if (strcasecmp(name, "PRI") == 0) return PRI;
+	if (strcasecmp(name, "PPRI") == 0) return PPRI;
+	if (strcasecmp(name, "EDF") == 0) return EDF;
+	if (strcasecmp(name, "RM") == 0) return RM;
+	if (strncasecmp(name, "RR", 2) == 0) { *quantum = atoi(name + 2); return *quantum > 0 ? RR : -1; }
+	if (strncasecmp(name, "LOTTERY", 7) == 0) { *quantum = atoi(name + 7); return *quantum > 0 ? LOTTERY : -1; }
+	if (strncasecmp(name, "STRIDE", 6) == 0) { *quantum = atoi(name + 6); return *quantum > 0 ? STRIDE : -1; }
+	return -1;
+}
+
+/*
+ * Predict the schedule the same way the simulator does, recording when every
+ * job first runs and when it finishes.
+ */
+void simulate(live_job_t *jobs, int n, int cores, scheme_t scheme, int quantum)
+{
+	scheduler_t *s = scheduler_create(cores, scheme);
+	int *remaining = malloc(n * sizeof(int));
+	int *core_job = malloc(cores * sizeof(int));
+	int *quantum_clock = malloc(cores * sizeof(int));
+	int timeslice = (scheme == RR || scheme == LOTTERY || scheme == STRIDE);
+	int i, c, done = 0, time;
+
+	for (i = 0; i < n; i++)
+	{
+		remaining[i] = jobs[i].in.run_time;
+		jobs[i].sim_start = -1;
+		jobs[i].sim_finish = -1;
+	}
+	for (c = 0; c < cores; c++)
+		core_job[c] = -1;
+
+	for (time = 0; done < n; time++)
+	{
+		for (c = 0; c < cores; c++)
+		{
+			int j = core_job[c];
+			if (j != -1 && remaining[j] == 0)
+			{
+				jobs[j].sim_finish = time;
+				done++;
+				core_job[c] = scheduler_job_finished_r(s, c, j, time);
+				quantum_clock[c] = quantum;
+			}
+		}
+
+		if (timeslice)
+			for (c = 0; c < cores; c++)
+				if (core_job[c] != -1 && quantum_clock[c] == 0)
+				{
+					core_job[c] = scheduler_quantum_expired_r(s, c, time);
+					quantum_clock[c] = quantum;
+				}
+
+		for (i = 0; i < n; i++)
+			if (jobs[i].in.arrival_time == time)
+			{
+				c = scheduler_new_rt_job_r(s, i, time, jobs[i].in.run_time, jobs[i].in.priority,
+						jobs[i].in.deadline, jobs[i].in.period);
+				if (c >= 0)
+				{
+					core_job[c] = i;
+					quantum_clock[c] = quantum;
+				}
+			}
+
+		for (c = 0; c < cores; c++)
+		{
+			int j = core_job[c];
+			if (j != -1)
+			{
+				if (jobs[j].sim_start == -1)
+					jobs[j].sim_start = time;
+				remaining[j]--;
+				quantum_clock[c]--;
+			}
+		}
+	}
+
+	scheduler_destroy(s);
+	free(remaining);
+	free(core_job);
+	free(quantum_clock);
+}
+
+/*
+ * Worker body: wait stopped until first scheduled, then burn cpu until
+ * it has used its share, stamp the finish time and exit.
+ */
+void worker(int index, double cpu_seconds)
+{
+	struct timespec ts;
+	volatile unsigned long spin = 0;
+
+	raise(SIGSTOP);
+
+	do
+	{
+		for (int k = 0; k < 10000; k++)
+			spin++;
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	} while (ts.tv_sec + ts.tv_nsec / 1e9 < cpu_seconds);
+
+	finish_stamp[index] = now();
+	_exit(0);
+}
+
+int main(int argc, char **argv)
+{
+	int c, i;
+	int cores = 0, scheme = -1, quantum = 0;
+	long unit_usec = 10000;
+	char *file_name;
+
+	while ((c = getopt(argc, argv, "c:s:u:")) != -1)
+	{
+		switch (c)
+		{
+			case 'c':
+				cores = atoi(optarg);
+				break;
+
+			case 's':
+				scheme = parse_scheme(optarg, &quantum);
+				break;
+
+			case 'u':
+				unit_usec = atol(optarg);
+				break;
+
+			case '?':
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (cores <= 0 || scheme == -1 || unit_usec <= 0 || optind != argc - 1)
+	{
+		fprintf(stderr, "Options -c <cores> and -s <scheme> and a single input file are required.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+	file_name = argv[optind];
+
+	trace_record_t *records;
+	long record_ct;
+	int load_status = trace_load(file_name, &records, &record_ct);
+	if (load_status != 0)
+	{
+		fprintf(stderr, "%s \"%s\".\n", trace_error(load_status), file_name);
+		return 2;
+	}
+
+	int n = (int)record_ct;
+	live_job_t *jobs = calloc(n > 0 ? n : 1, sizeof(live_job_t));
+	for (i = 0; i < n; i++)
+	{
+		jobs[i].in = records[i];
+		jobs[i].core_id = -1;
+	}
+	free(records);
+
+	/*
+	 * Map scheduler cores onto the cpus this process may run on.
+	 */
+	cpu_set_t allowed;
+	int cpus[CPU_SETSIZE], n_cpus = 0;
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+	for (i = 0; i < CPU_SETSIZE; i++)
+		if (CPU_ISSET(i, &allowed))
+			cpus[n_cpus++] = i;
+	if (cores > n_cpus)
+		fprintf(stderr, "Warning: %d core(s) requested but only %d cpu(s) available, cores will share cpus.\n", cores, n_cpus);
+
+	simulate(jobs, n, cores, scheme, quantum);
+
+	finish_stamp = mmap(NULL, (n > 0 ? n : 1) * sizeof(double), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (finish_stamp == MAP_FAILED)
+	{
+		perror("mmap");
+		return 2;
+	}
+
+	printf("Running %d job(s) live on %d core(s), one time unit = %ld usec...\n", n, cores, unit_usec);
+	fflush(stdout);
+
+	/*
+	 * Live run: one pass of the simulator's event loop per time unit, with
+	 * completions taken from real worker exits.
+	 */
+	scheduler_t *s = scheduler_create(cores, scheme);
+	int timeslice = (scheme == RR || scheme == LOTTERY || scheme == STRIDE);
+	int *core_job = malloc(cores * sizeof(int));
+	int *quantum_clock = malloc(cores * sizeof(int));
+	int done = 0, time, overrun_units = 0, signals = 0, unpinned = 0;
+	double unit = unit_usec / 1e6;
+
+	for (c = 0; c < cores; c++)
+		core_job[c] = -1;
+
+	clock_gettime(CLOCK_MONOTONIC, &run_epoch);
+
+	for (time = 0; done < n; time++)
+	{
+		// Sleep to the start of this time unit
+		double wake = time * unit;
+		struct timespec ts;
+		ts.tv_sec = run_epoch.tv_sec + (time_t)wake;
+		ts.tv_nsec = run_epoch.tv_nsec + (long)((wake - (time_t)wake) * 1e9);
+		if (ts.tv_nsec >= 1000000000L)
+		{
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+			;
+
+		/*
+		 * 1. Reap workers that exited and tell the scheduler. A worker that
+		 *    exits without a core (it overran, or lost the core before the
+		 *    SIGSTOP landed) is still queued in the library; it is finished
+		 *    when the library next hands it a core, in step 4.
+		 */
+		int status;
+		struct rusage usage;
+		pid_t pid;
+		while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0)
+		{
+			for (i = 0; i < n && jobs[i].pid != pid; i++)
+				;
+			if (i == n || !(WIFEXITED(status) || WIFSIGNALED(status)))
+				continue;
+
+			jobs[i].exited = 1;
+			jobs[i].t_cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+					usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+			done++;
+
+			c = jobs[i].core_id;
+			if (c != -1)
+			{
+				jobs[i].core_id = -1;
+				jobs[i].running = 0;
+				core_job[c] = scheduler_job_finished_r(s, c, i, time);
+				if (core_job[c] != -1)
+					jobs[core_job[c]].core_id = c;
+				quantum_clock[c] = quantum;
+			}
+		}
+
+		/*
+		 * 2. Expire quanta. A worker that overran its modeled run time keeps
+		 *    its core until it exits, so the library never drops a live job.
+		 */
+		if (timeslice)
+		{
+			for (c = 0; c < cores; c++)
+			{
+				int j = core_job[c];
+				if (j != -1 && quantum_clock[c] <= 0 && jobs[j].remaining > 0)
+				{
+					jobs[j].core_id = -1;
+					core_job[c] = scheduler_quantum_expired_r(s, c, time);
+					if (core_job[c] != -1)
+						jobs[core_job[c]].core_id = c;
+					quantum_clock[c] = quantum;
+				}
+			}
+		}
+
+		/*
+		 * 3. Start arriving jobs as stopped workers.
+		 */
+		for (i = 0; i < n; i++)
+		{
+			if (jobs[i].in.arrival_time != time)
+				continue;
+
+			fflush(stdout);
+			pid = fork();
+			if (pid == -1)
+			{
+				perror("fork");
+				return 3;
+			}
+			if (pid == 0)
+				worker(i, jobs[i].in.run_time * unit);
+
+			waitpid(pid, &status, WUNTRACED);
+			jobs[i].pid = pid;
+			jobs[i].arrived = 1;
+			jobs[i].remaining = jobs[i].in.run_time;
+
+			c = scheduler_new_rt_job_r(s, i, time, jobs[i].in.run_time, jobs[i].in.priority,
+					jobs[i].in.deadline, jobs[i].in.period);
+			if (c >= 0 && c < cores)
+			{
+				if (core_job[c] != -1)
+					jobs[core_job[c]].core_id = -1;
+				core_job[c] = i;
+				jobs[i].core_id = c;
+				quantum_clock[c] = quantum;
+			}
+		}
+
+		/*
+		 * 4. Enforce the assignment: stop everything that lost its core
+		 *    before continuing the workers that own one.
+		 */
+		for (i = 0; i < n; i++)
+		{
+			if (jobs[i].running && !jobs[i].exited && jobs[i].core_id == -1)
+			{
+				kill(jobs[i].pid, SIGSTOP);
+				jobs[i].running = 0;
+				signals++;
+			}
+		}
+
+		for (c = 0; c < cores; c++)
+		{
+			int j = core_job[c];
+			while (j != -1 && jobs[j].exited)
+			{
+				jobs[j].core_id = -1;
+				j = core_job[c] = scheduler_job_finished_r(s, c, j, time);
+				if (j != -1)
+					jobs[j].core_id = c;
+				quantum_clock[c] = quantum;
+			}
+			if (j == -1)
+				continue;
+
+			if (!jobs[j].running)
+			{
+				cpu_set_t pin;
+				CPU_ZERO(&pin);
+				CPU_SET(cpus[c % n_cpus], &pin);
+				// ESRCH only means the worker just exited; it is reaped next time unit
+				if (sched_setaffinity(jobs[j].pid, sizeof(pin), &pin) == -1 && errno != ESRCH)
+				{
+					fprintf(stderr, "Warning: cannot pin job %d to cpu %d: %s\n", j, cpus[c % n_cpus], strerror(errno));
+					unpinned++;
+				}
+
+				if (jobs[j].t_start == 0.0 && jobs[j].remaining == jobs[j].in.run_time)
+					jobs[j].t_start = now();
+				kill(jobs[j].pid, SIGCONT);
+				jobs[j].running = 1;
+				signals++;
+			}
+
+			if (jobs[j].remaining > 0)
+				jobs[j].remaining--;
+			else
+				overrun_units++;
+			quantum_clock[c]--;
+		}
+	}
+
+	scheduler_destroy(s);
+
+	/*
+	 * Compare the live run against the prediction.
+	 */
+	double sim_wait = 0, sim_turn = 0, sim_resp = 0;
+	double live_wait = 0, live_turn = 0, live_resp = 0;
+
+	printf("\nJob  Run | Predicted wait/resp/turn | Measured wait/resp/turn\n");
+	for (i = 0; i < n; i++)
+	{
+		double arrival = jobs[i].in.arrival_time * unit;
+		double turn = (finish_stamp[i] - arrival) / unit;
+		double resp = (jobs[i].t_start - arrival) / unit;
+		double wait = turn - jobs[i].t_cpu / unit;
+		int p_turn = jobs[i].sim_finish - jobs[i].in.arrival_time;
+		int p_resp = jobs[i].sim_start - jobs[i].in.arrival_time;
+		int p_wait = p_turn - jobs[i].in.run_time;
+
+		printf("%3d %4d | %8d %6d %6d   | %8.2f %6.2f %6.2f\n", i, jobs[i].in.run_time,
+				p_wait, p_resp, p_turn, wait, resp, turn);
+
+		sim_wait += p_wait;
+		sim_resp += p_resp;
+		sim_turn += p_turn;
+		live_wait += wait;
+		live_resp += resp;
+		live_turn += turn;
+	}
+
+	if (n > 0)
+	{
+		printf("\n                          Predicted   Measured\n");
+		printf("Average Waiting Time:     %9.2f  %9.2f\n", sim_wait / n, live_wait / n);
+		printf("Average Response Time:    %9.2f  %9.2f\n", sim_resp / n, live_resp / n);
+		printf("Average Turnaround Time:  %9.2f  %9.2f\n", sim_turn / n, live_turn / n);
+		printf("\nUnmodeled overhead: %.3f time units of turnaround per job (%.1f%%), "
+				"%d time unit(s) of overrun, %d stop/continue signal(s).\n",
+				(live_turn - sim_turn) / n, sim_turn > 0 ? 100.0 * (live_turn - sim_turn) / sim_turn : 0.0,
+				overrun_units, signals);
+		if (unpinned > 0)
+			printf("%d dispatch(es) ran unpinned, measurements may include cpu migration.\n", unpinned);
+	}
+
+	munmap(finish_stamp, (n > 0 ? n : 1) * sizeof(double));
+	free(core_job);
+	free(quantum_clock);
+	free(jobs);
+
+	return 0;
+}
@@ -16,6 +16,12 @@ int compare2(const void * a, const void * b)
 	return ( *(int*)b - *(int*)a );
 }
 
+int compare_idx(uint32_t a, uint32_t b, void * ctx)
+{
+	int *values = ctx;
+	return ( values[b] - values[a] );
+}
+
 int main()
 {
 	priqueue_t q, q2;
@@ -68,6 +74,29 @@ int main()
 	priqueue_destroy(&q2);
 	priqueue_destroy(&q);
 
+	/* An index heap orders slots by the values they index. */
+	idxheap_t ih;
+	idxheap_init(&ih, compare_idx, values);
+
+	for (i = 99; i >= 0; i -= 3)
+		idxheap_offer(&ih, 99 - i);
+	printf("Index heap elements: %d (expected 34).\n", idxheap_size(&ih));
+
+	printf("Index heap poll order (expected 99 96 93 90): ");
+	for (i = 0; i < 4; i++)
+		printf("%u ", idxheap_poll(&ih));
+	printf("\n");
+
+	uint32_t batch[5] = { 5, 50, 97, 1, 98 };
+	idxheap_offer_all(&ih, batch, 5);
+	printf("Index heap after batch (expected 98 97 87 84): ");
+	for (i = 0; i < 4; i++)
+		printf("%u ", idxheap_poll(&ih));
+	printf("\n");
+
+	idxheap_destroy(&ih);
+	printf("Empty index heap poll: %d (expected 1).\n", idxheap_poll(&ih) == IDXHEAP_EMPTY);
+
 	free(values);
 
 	return 0;
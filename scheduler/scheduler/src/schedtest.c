@@ -0,0 +1,512 @@
+/** @file schedtest.c
+ *
+ * Differential test for libscheduler. Random job sets are scheduled twice with
+ * the same event loop as the simulator: once by the library and once by a
+ * reference model that keeps every job in a plain array and rescans it on
+ * every decision. The core assignments of every time unit, and the final
+ * averages, must agree for every scheme.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libscheduler/libscheduler.h"
+
+#define MAX_JOBS  64
+#define MAX_CORES 4
+#define STRIDE1   (1 << 20) //must match the library
+#define NO_KEY    0x7fffffffL
+
+
+/*
+ * Reference model
+ */
+typedef struct _ref_job_t
+{
+	int arrival, run, priority, deadline, period;
+	int remaining;
+	int core;       // -1 unless running
+	int waiting;    // arrived and waiting for a core
+	int finished;
+	long seq;       // when it last joined the wait queue, FIFO order
+	long key;       // STRIDE pass, EDF absolute deadline, RM period
+	int tickets;
+} ref_job_t;
+
+typedef struct _ref_t
+{
+	scheme_t scheme;
+	int cores;
+	int core_job[MAX_CORES];
+	ref_job_t jobs[MAX_JOBS];
+	int last_time;
+	long seq;
+	long global_pass;
+	unsigned int seed; // LOTTERY random state, seeded as the library does
+} ref_t;
+
+void ref_init(ref_t *r, int cores, scheme_t scheme)
+{
+	memset(r, 0, sizeof(ref_t));
+	r->scheme = scheme;
+	r->cores = cores;
+	for (int c = 0; c < MAX_CORES; c++)
+		r->core_job[c] = -1;
+	r->seed = 1;
+}
+
+// Charge running jobs for the time since the previous call
+void ref_advance(ref_t *r, int time)
+{
+	for (int c = 0; c < r->cores; c++)
+		if (r->core_job[c] != -1)
+			r->jobs[r->core_job[c]].remaining -= time - r->last_time;
+	r->last_time = time;
+}
+
+// Nonzero if job a should be picked over job b while both wait
+int ref_before(ref_t *r, int a, int b)
+{
+	ref_job_t *x = &r->jobs[a], *y = &r->jobs[b];
+	switch (r->scheme)
+	{
+		case SJF:
+			if (x->run != y->run) return x->run < y->run;
+			break;
+		case PSJF:
+			if (x->remaining != y->remaining) return x->remaining < y->remaining;
+			return x->seq < y->seq;
+		case PRI:
+		case PPRI:
+			if (x->priority != y->priority) return x->priority < y->priority;
+			break;
+		case STRIDE:
+		case EDF:
+		case RM:
+			if (x->key != y->key) return x->key < y->key;
+			return a < b;
+		case RR:
+		case LOTTERY:
+			return x->seq < y->seq;
+		default:
+			break;
+	}
+	// A job keeps its place in line from when it first arrived
+	return x->arrival < y->arrival;
+}
+
+void ref_wait(ref_t *r, int j)
+{
+	r->jobs[j].core = -1;
+	r->jobs[j].waiting = 1;
+	r->jobs[j].seq = r->seq++;
+}
+
+void ref_run(ref_t *r, int j, int core)
+{
+	r->jobs[j].waiting = 0;
+	r->jobs[j].core = core;
+	r->core_job[core] = j;
+}
+
+// Pick the next waiting job for an idle core, -1 if none wait
+int ref_next(ref_t *r, int core)
+{
+	int j, best = -1;
+
+	if (r->scheme == LOTTERY)
+	{
+		// Tickets are counted in wait queue order, as the library draws them
+		int total = 0, order[MAX_JOBS], n = 0;
+		for (j = 0; j < MAX_JOBS; j++)
+			if (r->jobs[j].waiting)
+				order[n++] = j;
+		for (int a = 1; a < n; a++)
+			for (int b = a; b > 0 && r->jobs[order[b]].seq < r->jobs[order[b - 1]].seq; b--)
+			{
+				int t = order[b];
+				order[b] = order[b - 1];
+				order[b - 1] = t;
+			}
+		if (n == 0)
+			return -1;
+		for (j = 0; j < n; j++)
+			total += r->jobs[order[j]].tickets;
+		int winner = rand_r(&r->seed) % total;
+		for (j = 0; j < n; j++)
+		{
+			best = order[j];
+			winner -= r->jobs[best].tickets;
+			if (winner < 0)
+				break;
+		}
+	}
+	else
+	{
+		for (j = 0; j < MAX_JOBS; j++)
+			if (r->jobs[j].waiting && (best == -1 || ref_before(r, j, best)))
+				best = j;
+	}
+
+	if (best == -1)
+		return -1;
+	if (r->scheme == STRIDE && r->jobs[best].key > r->global_pass)
+		r->global_pass = r->jobs[best].key;
+	ref_run(r, best, core);
+	return best;
+}
+
+int ref_new_job(ref_t *r, int j, int time, int run, int priority, int deadline, int period)
+{
+	ref_job_t *job = &r->jobs[j];
+	int c, victim = -1;
+
+	ref_advance(r, time);
+	job->arrival = time;
+	job->run = run;
+	job->remaining = run;
+	job->priority = priority;
+	job->deadline = deadline;
+	job->period = period;
+	job->tickets = scheduler_tickets(priority);
+	if (r->scheme == STRIDE)
+		job->key = r->global_pass;
+	else if (r->scheme == EDF)
+		job->key = deadline > 0 ? time + deadline : NO_KEY;
+	else if (r->scheme == RM)
+		job->key = period > 0 ? period : (deadline > 0 ? deadline : NO_KEY);
+
+	for (c = 0; c < r->cores; c++)
+		if (r->core_job[c] == -1)
+		{
+			ref_run(r, j, c);
+			return c;
+		}
+
+	// Every core is busy, preemptive schemes displace their worst running job
+	for (c = 0; c < r->cores; c++)
+	{
+		ref_job_t *cur = &r->jobs[r->core_job[c]];
+		ref_job_t *worst = victim == -1 ? NULL : &r->jobs[r->core_job[victim]];
+		if (r->scheme == PSJF && cur->remaining > run &&
+				(worst == NULL || cur->remaining > worst->remaining))
+			victim = c;
+		else if (r->scheme == PPRI && cur->priority > priority &&
+				(worst == NULL || cur->priority > worst->priority ||
+				 (cur->priority == worst->priority && cur->arrival > worst->arrival)))
+			victim = c;
+		else if ((r->scheme == EDF || r->scheme == RM) &&
+				(worst == NULL || ref_before(r, r->core_job[victim], r->core_job[c])))
+			victim = c;
+	}
+	if ((r->scheme == EDF || r->scheme == RM) && !ref_before(r, j, r->core_job[victim]))
+		victim = -1;
+
+	if (victim != -1)
+	{
+		ref_wait(r, r->core_job[victim]);
+		ref_run(r, j, victim);
+		return victim;
+	}
+
+	ref_wait(r, j);
+	return -1;
+}
+
+int ref_job_finished(ref_t *r, int core, int j, int time)
+{
+	ref_advance(r, time);
+	r->jobs[j].core = -1;
+	r->jobs[j].finished = 1;
+	r->core_job[core] = -1;
+	return ref_next(r, core);
+}
+
+int ref_quantum_expired(ref_t *r, int core, int time)
+{
+	int j = r->core_job[core];
+
+	ref_advance(r, time);
+	r->core_job[core] = -1;
+	if (r->scheme == STRIDE)
+		r->jobs[j].key += STRIDE1 / r->jobs[j].tickets;
+	ref_wait(r, j);
+	return ref_next(r, core);
+}
+
+
+/*
+ * Shared driver, the simulator's event loop
+ */
+typedef struct _workload_t
+{
+	int n;
+	int arrival[MAX_JOBS], run[MAX_JOBS], priority[MAX_JOBS], deadline[MAX_JOBS], period[MAX_JOBS];
+} workload_t;
+
+typedef struct _outcome_t
+{
+	int ticks;
+	int *assigned;  // ticks x cores, the job each core ran, -1 when idle
+	float waiting, turnaround, response;
+} outcome_t;
+
+/*
+ * Runs the workload to completion with either the library (s != NULL) or the
+ * reference model (r != NULL). A batched library run hands every arrival of a
+ * time unit to scheduler_new_jobs_r() at once.
+ */
+void drive(workload_t *w, int cores, scheme_t scheme, int quantum, scheduler_t *s, ref_t *r, int batched, outcome_t *out)
+{
+	scheduler_arrival_t batch[MAX_JOBS];
+	int batch_job[MAX_JOBS], n_batch;
+	int remaining[MAX_JOBS], first_run[MAX_JOBS], finish[MAX_JOBS];
+	int core_job[MAX_CORES], quantum_clock[MAX_CORES];
+	int timeslice = (scheme == RR || scheme == LOTTERY || scheme == STRIDE);
+	int i, c, time, done = 0, capacity = 64;
+
+	out->ticks = 0;
+	out->assigned = malloc(capacity * cores * sizeof(int));
+
+	for (i = 0; i < w->n; i++)
+	{
+		remaining[i] = w->run[i];
+		first_run[i] = -1;
+	}
+	for (c = 0; c < cores; c++)
+		core_job[c] = -1;
+
+	for (time = 0; done < w->n; time++)
+	{
+		// 1. Finished jobs
+		for (c = 0; c < cores; c++)
+		{
+			int j = core_job[c];
+			if (j != -1 && remaining[j] == 0)
+			{
+				finish[j] = time;
+				done++;
+				core_job[c] = s ? scheduler_job_finished_r(s, c, j, time) : ref_job_finished(r, c, j, time);
+				quantum_clock[c] = quantum;
+			}
+		}
+		if (done == w->n)
+			break;
+
+		// 2. Expired quanta
+		if (timeslice)
+			for (c = 0; c < cores; c++)
+				if (core_job[c] != -1 && quantum_clock[c] == 0)
+				{
+					core_job[c] = s ? scheduler_quantum_expired_r(s, c, time) : ref_quantum_expired(r, c, time);
+					quantum_clock[c] = quantum;
+				}
+
+		// 3. Arrivals
+		if (batched)
+		{
+			n_batch = 0;
+			for (i = 0; i < w->n; i++)
+				if (w->arrival[i] == time)
+				{
+					batch[n_batch] = (scheduler_arrival_t){ i, w->run[i], w->priority[i], w->deadline[i], w->period[i], -1 };
+					batch_job[n_batch++] = i;
+				}
+			scheduler_new_jobs_r(s, batch, n_batch, time);
+			for (i = 0; i < n_batch; i++)
+				if (batch[i].core_id >= 0)
+				{
+					core_job[batch[i].core_id] = batch_job[i];
+					quantum_clock[batch[i].core_id] = quantum;
+				}
+		}
+		else for (i = 0; i < w->n; i++)
+			if (w->arrival[i] == time)
+			{
+				c = s ? scheduler_new_rt_job_r(s, i, time, w->run[i], w->priority[i], w->deadline[i], w->period[i])
+					: ref_new_job(r, i, time, w->run[i], w->priority[i], w->deadline[i], w->period[i]);
+				if (c >= 0 && c < cores)
+				{
+					core_job[c] = i;
+					quantum_clock[c] = quantum;
+				}
+			}
+
+		// 4. Run the time unit
+		if (out->ticks == capacity)
+		{
+			capacity *= 2;
+			out->assigned = realloc(out->assigned, capacity * cores * sizeof(int));
+		}
+		for (c = 0; c < cores; c++)
+		{
+			int j = core_job[c];
+			out->assigned[out->ticks * cores + c] = j;
+			if (j != -1)
+			{
+				if (first_run[j] == -1)
+					first_run[j] = time;
+				remaining[j]--;
+				quantum_clock[c]--;
+			}
+		}
+		out->ticks++;
+	}
+
+	if (s)
+	{
+		out->waiting = scheduler_average_waiting_time_r(s);
+		out->turnaround = scheduler_average_turnaround_time_r(s);
+		out->response = scheduler_average_response_time_r(s);
+	}
+	else
+	{
+		// Straight from the schedule
+		float wait = 0, turn = 0, resp = 0;
+		for (i = 0; i < w->n; i++)
+		{
+			turn += finish[i] - w->arrival[i];
+			wait += finish[i] - w->arrival[i] - w->run[i];
+			resp += first_run[i] - w->arrival[i];
+		}
+		out->waiting = wait / w->n;
+		out->turnaround = turn / w->n;
+		out->response = resp / w->n;
+	}
+}
+
+
+/*
+ * Random workloads
+ */
+unsigned long long rng_state;
+
+unsigned int rng_next(unsigned int bound)
+{
+	unsigned long long z = (rng_state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return (unsigned int)((z ^ (z >> 31)) % bound);
+}
+
+void generate(workload_t *w)
+{
+	int i, time = 0;
+
+	w->n = 1 + rng_next(MAX_JOBS);
+	for (i = 0; i < w->n; i++)
+	{
+		// Every fourth job arrives together with the one before it
+		time += rng_next(4) == 0 ? 0 : 1 + rng_next(4);
+		w->arrival[i] = time;
+		w->run[i] = 1 + rng_next(12);
+		w->priority[i] = rng_next(6);
+		w->deadline[i] = rng_next(3) ? w->run[i] * (1 + rng_next(4)) : 0;
+		w->period[i] = rng_next(2) ? 2 + rng_next(20) : 0;
+	}
+}
+
+void print_workload(workload_t *w)
+{
+	fprintf(stderr, "  Jobs (arrival, run, priority, deadline, period):\n");
+	for (int i = 0; i < w->n; i++)
+		fprintf(stderr, "    %d: %d,%d,%d,%d,%d\n", i, w->arrival[i], w->run[i], w->priority[i], w->deadline[i], w->period[i]);
+}
+
+/*
+ * Reports the first difference between a library run and the reference, returns
+ * 0 when they agree.
+ */
+int compare(outcome_t *lib, outcome_t *ref, int cores, const char *name, const char *how)
+{
+	int t, c;
+
+	for (t = 0; t < lib->ticks && t < ref->ticks; t++)
+		for (c = 0; c < cores; c++)
+			if (lib->assigned[t * cores + c] != ref->assigned[t * cores + c])
+			{
+				fprintf(stderr, "%s on %d core(s), %s: core %d runs job %d at time %d, reference runs job %d.\n",
+						name, cores, how, c, lib->assigned[t * cores + c], t, ref->assigned[t * cores + c]);
+				return 1;
+			}
+
+	if (lib->ticks != ref->ticks)
+	{
+		fprintf(stderr, "%s on %d core(s), %s: library finished at time %d, reference at %d.\n", name, cores, how, lib->ticks, ref->ticks);
+		return 1;
+	}
+
+	if (lib->waiting != ref->waiting || lib->turnaround != ref->turnaround || lib->response != ref->response)
+	{
+		fprintf(stderr, "%s on %d core(s), %s: averages %.2f/%.2f/%.2f, reference %.2f/%.2f/%.2f (waiting/turnaround/response).\n",
+				name, cores, how, lib->waiting, lib->turnaround, lib->response, ref->waiting, ref->turnaround, ref->response);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Schedules one workload with the library, one arrival at a time and batched,
+ * and with the reference. Returns 0 when all three agree.
+ */
+int check(workload_t *w, int cores, scheme_t scheme, int quantum, const char *name)
+{
+	outcome_t single, batched, ref;
+	ref_t *r = malloc(sizeof(ref_t));
+	scheduler_t *s = scheduler_create(cores, scheme);
+	int failed;
+
+	ref_init(r, cores, scheme);
+	drive(w, cores, scheme, quantum, NULL, r, 0, &ref);
+	drive(w, cores, scheme, quantum, s, NULL, 0, &single);
+	scheduler_destroy(s);
+	s = scheduler_create(cores, scheme);
+	drive(w, cores, scheme, quantum, s, NULL, 1, &batched);
+
+	failed = compare(&single, &ref, cores, name, "one at a time") ||
+			compare(&batched, &ref, cores, name, "batched");
+	if (failed)
+		print_workload(w);
+
+	scheduler_destroy(s);
+	free(single.assigned);
+	free(batched.assigned);
+	free(ref.assigned);
+	free(r);
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	const struct { scheme_t scheme; const char *name; } schemes[] =
+	{
+		{ FCFS, "fcfs" }, { SJF, "sjf" }, { PSJF, "psjf" }, { PRI, "pri" }, { PPRI, "ppri" },
+		{ RR, "rr" }, { LOTTERY, "lottery" }, { STRIDE, "stride" }, { EDF, "edf" }, { RM, "rm" },
+	};
+	int rounds = argc > 1 ? atoi(argv[1]) : 200;
+	unsigned long long seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+	int round, k, failures = 0, checks = 0;
+	workload_t w;
+
+	rng_state = seed;
+	for (round = 0; round < rounds; round++)
+	{
+		generate(&w);
+		int cores = 1 + rng_next(MAX_CORES);
+		int quantum = 1 + rng_next(4);
+
+		for (k = 0; k < (int)(sizeof(schemes) / sizeof(schemes[0])); k++)
+		{
+			checks++;
+			if (check(&w, cores, schemes[k].scheme, quantum, schemes[k].name))
+			{
+				fprintf(stderr, "  (round %d, seed %llu, quantum %d)\n", round, seed, quantum);
+				failures++;
+			}
+		}
+	}
+
+	printf("Random schedules checked against the reference: %d, mismatches: %d (expected 0).\n", checks, failures);
+	return failures != 0;
+}
@@ -8,22 +8,192 @@
 #include <unistd.h>
 #include <string.h>
 #include <assert.h>
+#include <ctype.h>
+#include <math.h>
 
 #include "libscheduler/libscheduler.h"
+#include "trace/trace.h"
 
 
 typedef struct _simulator_job_list_t
 {
-	int job_id, arrival_time, run_time, priority;
-	int core_id, arrived;
+	int job_id, arrival_time, run_time;
+	int core_id, arrived, tickets;
 } simulator_job_list_t;
 
+/*
+ * The input jobs, indexed by job id. A binary trace is read straight from its
+ * mapping; CSV has nothing to map, so it is parsed into an array of records.
+ */
+typedef struct _workload_t
+{
+	trace_t trace;           // mapped binary trace, base is NULL for CSV
+	trace_record_t *records; // parsed CSV, NULL for a binary trace
+	long count;
+} workload_t;
+
+/*
+ * Opens a workload for reading. Returns 0 or a TRACE_ERR_* code.
+ */
+int workload_open(workload_t *w, const char *path)
+{
+	int status = trace_open(&w->trace, path);
+
+	w->records = NULL;
+	if (status == 0)
+	{
+		w->count = w->trace.count;
+		return 0;
+	}
+
+	w->trace.base = NULL;
+	if (status < 0)
+		return status;
+	return trace_load(path, &w->records, &w->count);
+}
+
+void workload_record(const workload_t *w, long job_id, trace_record_t *r)
+{
+	if (w->records != NULL)
+		*r = w->records[job_id];
+	else
+		trace_record(&w->trace, job_id, r);
+}
+
+void workload_close(workload_t *w)
+{
+	if (w->trace.base != NULL)
+		trace_close(&w->trace);
+	free(w->records);
+}
+
 void print_usage(char *program_name)
 {
 	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> <input file>\n", program_name);
+	fprintf(stderr, "       The input file is CSV or a binary trace written by tracegen.\n");
 	fprintf(stderr, "       %s -c 2 -s fcfs examples/proc1.csv\n", program_name);
 	fprintf(stderr, "\n");
-	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#\n");
+	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#, lottery#, stride#, edf, rm\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Input lines are: arrival time, run time, priority[, deadline[, period]]\n");
+	fprintf(stderr, "The deadline is relative to arrival; 0 or absent means none.\n");
+}
+
+int compare_int(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+	return (x > y) - (x < y);
+}
+
+typedef struct _density_event_t
+{
+	int time;
+	double delta; // density added when a window opens, removed when it closes
+} density_event_t;
+
+int compare_density_event(const void *a, const void *b)
+{
+	const density_event_t *x = a, *y = b;
+	if (x->time != y->time)
+		return (x->time > y->time) - (x->time < y->time);
+	// A window closing at t ends before one opening at t
+	return (x->delta > y->delta) - (x->delta < y->delta);
+}
+
+/*
+ * Report deadline misses and lateness of every job that has a deadline, and
+ * test whether the workload is schedulable at all.
+ *
+ * Schedulability uses the peak density: the largest sum of run/min(deadline, period)
+ * over jobs whose windows [arrival, arrival + window) overlap. For periodic tasks
+ * with deadline <= period this is the task set utilization, which is then checked
+ * against the Liu-Layland bound (RM, one core), U <= 1 (EDF, one core) or the
+ * global bounds of Goossens-Funk-Baruah (EDF) and Bertogna et al. (RM) on more
+ * cores. The sweep is one sort of 2n events, so it stays cheap for millions of jobs.
+ */
+void print_deadline_report(const workload_t *w, int *finish, int cores)
+{
+	int i, windows = 0, deadlines = 0, misses = 0;
+	int n = (int)w->count;
+	int *lateness = malloc(n * sizeof(int));
+	density_event_t *events = malloc(2 * n * sizeof(density_event_t));
+	double lateness_sum = 0.0, density_max = 0.0;
+
+	for (i = 0; i < n; i++)
+	{
+		trace_record_t info;
+		workload_record(w, i, &info);
+
+		int window = info.deadline;
+		if (window == 0 || (info.period > 0 && info.period < window))
+			window = info.period;
+		if (window == 0)
+			continue;
+
+		// Only jobs with an explicit deadline count towards misses and lateness
+		if (info.deadline > 0)
+		{
+			int late = finish[i] - (info.arrival_time + info.deadline);
+			if (late > 0)
+				misses++;
+			lateness_sum += late;
+			lateness[deadlines++] = late;
+		}
+
+		double density = (double)info.run_time / window;
+		if (density > density_max)
+			density_max = density;
+		events[windows].time = info.arrival_time;
+		events[windows++].delta = density;
+		events[windows].time = info.arrival_time + window;
+		events[windows++].delta = -density;
+	}
+
+	if (windows > 0)
+	{
+		printf("\nDeadlines:\n");
+		if (deadlines > 0)
+		{
+			qsort(lateness, deadlines, sizeof(int), compare_int);
+			printf("  Missed: %d of %d (%.2f%%)\n", misses, deadlines, 100.0 * misses / deadlines);
+			printf("  Lateness: min=%d p50=%d p90=%d p99=%d max=%d mean=%.2f\n", lateness[0],
+					lateness[(deadlines - 1) / 2], lateness[(int)((deadlines - 1) * 0.9)],
+					lateness[(int)((deadlines - 1) * 0.99)], lateness[deadlines - 1], lateness_sum / deadlines);
+		}
+
+		qsort(events, windows, sizeof(density_event_t), compare_density_event);
+
+		double load = 0.0, load_max = 0.0;
+		int active = 0, active_max = 0;
+		for (i = 0; i < windows; i++)
+		{
+			load += events[i].delta;
+			active += (events[i].delta > 0) ? 1 : -1;
+			if (load > load_max)
+				load_max = load;
+			if (active > active_max)
+				active_max = active;
+		}
+
+		double edf_bound, rm_bound;
+		if (cores == 1)
+		{
+			edf_bound = 1.0;
+			rm_bound = active_max * (pow(2.0, 1.0 / active_max) - 1.0);
+		}
+		else
+		{
+			edf_bound = cores - (cores - 1) * density_max;
+			rm_bound = cores / 2.0 * (1.0 - density_max) + density_max;
+		}
+
+		printf("  Peak density: %.3f over %d concurrent job(s), max job density %.3f\n", load_max, active_max, density_max);
+		printf("  Schedulable under EDF: %s (bound %.3f)\n", load_max <= edf_bound + 1e-9 ? "yes" : "not guaranteed", edf_bound);
+		printf("  Schedulable under RM: %s (bound %.3f)\n", load_max <= rm_bound + 1e-9 ? "yes" : "not guaranteed", rm_bound);
+	}
+
+	free(lateness);
+	free(events);
 }
 
 int set_active_job(int job_id, int core_id, simulator_job_list_t *jobs, int active_jobs)
@@ -81,7 +251,7 @@ void print_available_cores(int cores)
 
 int main(int argc, char **argv)
 {
-	int c;
+	int c, i, j, k;
 	int cores = 0, scheme = -1, quantum = 0;
 	char *file_name;
 
@@ -109,6 +279,8 @@ int main(int argc, char **argv)
 				else if (strcasecmp(optarg, "PSJF") == 0) { scheme = PSJF; }
 				else if (strcasecmp(optarg, "PRI") == 0) { scheme = PRI; }
 				else if (strcasecmp(optarg, "PPRI") == 0) { scheme = PPRI; }
+				else if (strcasecmp(optarg, "EDF") == 0) { scheme = EDF; }
+				else if (strcasecmp(optarg, "RM") == 0) { scheme = RM; }
 				else if (strncasecmp(optarg, "RR", 2) == 0)
 				{
 					scheme = RR;
@@ -121,6 +293,18 @@ int main(int argc, char **argv)
 						return 1;
 					}
 				}
+				else if (strncasecmp(optarg, "LOTTERY", 7) == 0 || strncasecmp(optarg, "STRIDE", 6) == 0)
+				{
+					scheme = (toupper(optarg[0]) == 'L') ? LOTTERY : STRIDE;
+					quantum = atoi(optarg + (scheme == LOTTERY ? 7 : 6));
+
+					if (quantum <= 0)
+					{
+						fprintf(stderr, "Option -s <scheme> requires a positive number for the quantum of LOTTERY and STRIDE. (Eg: -s STRIDE2)\n");
+						print_usage(argv[0]);
+						return 1;
+					}
+				}
 				break;
 
 			case '?':
@@ -158,59 +342,48 @@ int main(int argc, char **argv)
 
 
 	/*
-	 * Open the file, read the file, and populate the jobs data structure.
+	 * Open the file and populate the jobs data structure. Only what the
+	 * simulation changes is kept per job; the rest is read from the workload
+	 * when the job arrives.
 	 */
-	FILE *file = fopen(file_name, "r");
-	if (file == NULL)
+	workload_t workload;
+	int load_status = workload_open(&workload, file_name);
+
+	if (load_status == TRACE_ERR_CSV)
 	{
-		fprintf(stderr, "Unable to open file \"%s\".\n", file_name);
+		fprintf(stderr, "Illegal file format.\n");
 		return 2;
 	}
-
-
-	int job_id = 0;
-	int jobs_ct = 10;
-	simulator_job_list_t* jobs = malloc(jobs_ct * sizeof(simulator_job_list_t));
-
-	char line[1024 + 1];
-	fgets(line, 1024, file);  // Ignore the first (header) line
-	while (fgets(line, 1024, file) != NULL)
+	else if (load_status == TRACE_ERR_MEMORY)
 	{
-		char *arrival_time = strtok(line, ",");
-		char *run_time = strtok(NULL, ",");
-		char *priority = strtok(NULL, ",");
-
-		if (arrival_time != NULL && run_time != NULL && priority != NULL)
-		{
-			if (job_id == jobs_ct)
-			{
-				jobs_ct *= 2;
-				jobs = realloc(jobs, jobs_ct * sizeof(simulator_job_list_t));
-
-				if (!jobs)
-				{
-					fprintf(stderr, "Out of memory.\n");
-					return 2;
-				}
-			}
-
-			jobs[job_id].job_id = job_id;
-			jobs[job_id].arrival_time = atoi(arrival_time);
-			jobs[job_id].run_time = atoi(run_time);
-			jobs[job_id].priority = atoi(priority);
-			jobs[job_id].core_id = -1;
-			jobs[job_id].arrived = 0;
+		fprintf(stderr, "Out of memory.\n");
+		return 2;
+	}
+	else if (load_status != 0)
+	{
+		fprintf(stderr, "%s \"%s\".\n", trace_error(load_status), file_name);
+		return 2;
+	}
 
-			job_id++;
-		}
-		else
-		{
-			fprintf(stderr, "Illegal file format.\n");
-			return 2;
-		}
+	int job_id;
+	simulator_job_list_t* jobs = malloc((workload.count > 0 ? workload.count : 1) * sizeof(simulator_job_list_t));
+	if (!jobs)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		return 2;
 	}
 
-	fclose(file);
+	for (job_id = 0; job_id < workload.count; job_id++)
+	{
+		trace_record_t r;
+		workload_record(&workload, job_id, &r);
+		jobs[job_id].job_id = job_id;
+		jobs[job_id].arrival_time = r.arrival_time;
+		jobs[job_id].run_time = r.run_time;
+		jobs[job_id].core_id = -1;
+		jobs[job_id].arrived = 0;
+		jobs[job_id].tickets = scheduler_tickets(r.priority);
+	}
 
 
 	/*
@@ -224,15 +397,35 @@ int main(int argc, char **argv)
 	else if (scheme == PRI) { printf("Non-preemptive Priority (PRI)"); }
 	else if (scheme == PPRI) { printf("Preemptive Priority (PPRI)"); }
 	else if (scheme == RR) { printf("Round Robin (RR) with a quantum of %d", quantum); }
+	else if (scheme == LOTTERY) { printf("Lottery (LOTTERY) with a quantum of %d", quantum); }
+	else if (scheme == STRIDE) { printf("Stride (STRIDE) with a quantum of %d", quantum); }
+	else if (scheme == EDF) { printf("Earliest Deadline First (EDF)"); }
+	else if (scheme == RM) { printf("Rate Monotonic (RM)"); }
 	printf(" scheduling...\n\n");
 
 	scheduler_start_up(cores, scheme);
 
+	// Quantum driven schemes get a scheduler_quantum_expired() call per quantum
+	int timeslice = (scheme == RR || scheme == LOTTERY || scheme == STRIDE);
+	int proportional = (scheme == LOTTERY || scheme == STRIDE);
+
+	// Per job cpu received and cpu entitled to by weight, indexed by job id
+	int total_jobs = job_id;
+	int *fair_cpu = proportional ? calloc(total_jobs, sizeof(int)) : NULL;
+	float *fair_entitled = proportional ? calloc(total_jobs, sizeof(float)) : NULL;
 
-	int time = 0, i, j;
+	// The job list is compacted as jobs finish, so keep finish times by job id
+	int *finish_time = malloc((total_jobs > 0 ? total_jobs : 1) * sizeof(int));
+
+
+	int time = 0;
 	int active_jobs = job_id, jobs_alive = 0;
 
+	// Sized for the largest batch of arrivals seen so far
 	int *quantum_clock = malloc(cores * sizeof(int));
+	int arrivals_capacity = 16;
+	scheduler_arrival_t *arrivals = malloc(arrivals_capacity * sizeof(scheduler_arrival_t));
+	int *arrival_index = malloc(arrivals_capacity * sizeof(int));
 	char **core_timing_diagram = malloc(cores * sizeof(char *));
 	int core_timing_diagram_size = 1024;
 
@@ -257,9 +450,10 @@ int main(int argc, char **argv)
 				// Notify the scheduler has finished
 				int job_id = jobs[i].job_id;
 				int core_id = jobs[i].core_id;
+				finish_time[job_id] = time;
 				int new_job_id = scheduler_job_finished(jobs[i].core_id, jobs[i].job_id, time);
 
-				if (scheme == RR)
+				if (timeslice)
 					quantum_clock[jobs[i].core_id] = quantum;
 
 				// Delete the finished jobs, decrease the number of active jobs
@@ -293,7 +487,7 @@ int main(int argc, char **argv)
 		/*
 		 * 2. Check of any quantums expired in the last time unit.
 		 */
-		if (scheme == RR)
+		if (timeslice)
 		{
 			for (i = 0; i < cores; i++)
 			{
@@ -336,47 +530,73 @@ int main(int argc, char **argv)
 		/*
 		 * 3. Check for any new jobs that arrive in this time unit
 		 */
+		int n_arrivals = 0;
 		for (i = 0; i < active_jobs; i++)
 		{
 			if (jobs[i].arrival_time == time)
 			{
-				int new_job_core_id = scheduler_new_job(jobs[i].job_id, time, jobs[i].run_time, jobs[i].priority);
-				jobs[i].arrived = 1;
-				jobs_alive++;
-
-				if (new_job_core_id >= 0 && new_job_core_id < cores)
+				if (n_arrivals == arrivals_capacity)
 				{
-					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
-							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id, new_job_core_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+					arrivals_capacity *= 2;
+					arrivals = realloc(arrivals, arrivals_capacity * sizeof(scheduler_arrival_t));
+					arrival_index = realloc(arrival_index, arrivals_capacity * sizeof(int));
+					if (arrivals == NULL || arrival_index == NULL)
+					{
+						fprintf(stderr, "Out of memory.\n");
+						return 3;
+					}
+				}
 
-					// Find if anyone is currently using the core.
-					for (j = 0; j < active_jobs; j++)
-						if (jobs[j].core_id == new_job_core_id)
-							jobs[j].core_id = -1;
+				trace_record_t r;
+				workload_record(&workload, jobs[i].job_id, &r);
+				arrivals[n_arrivals] = (scheduler_arrival_t){ jobs[i].job_id, jobs[i].run_time, r.priority,
+						r.deadline, r.period, -1 };
+				arrival_index[n_arrivals++] = i;
+			}
+		}
 
-					// Assign the core to the new job
-					jobs[i].core_id = new_job_core_id;
+		// Everything arriving together is placed with one call
+		if (n_arrivals > 0)
+			scheduler_new_jobs(arrivals, n_arrivals, time);
 
-					if (scheme == RR)
-						quantum_clock[new_job_core_id] = quantum;
-				}
-				else if (new_job_core_id == -1)
-				{
-					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
-							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-				}
-				else
-				{
-					printf("The scheduler_new_job() selected an invalid core (core_id == %d).\n", new_job_core_id);
-					print_available_cores(cores);
-					return 3;
-				}
+		for (k = 0; k < n_arrivals; k++)
+		{
+			i = arrival_index[k];
+			int new_job_core_id = arrivals[k].core_id;
+			jobs[i].arrived = 1;
+			jobs_alive++;
+
+			if (new_job_core_id >= 0 && new_job_core_id < cores)
+			{
+				printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
+						jobs[i].job_id, jobs[i].run_time, arrivals[k].priority, jobs[i].job_id, new_job_core_id);
+				printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+
+				// Find if anyone is currently using the core.
+				for (j = 0; j < active_jobs; j++)
+					if (jobs[j].core_id == new_job_core_id)
+						jobs[j].core_id = -1;
+
+				// Assign the core to the new job
+				jobs[i].core_id = new_job_core_id;
+
+				if (timeslice)
+					quantum_clock[new_job_core_id] = quantum;
+			}
+			else if (new_job_core_id == -1)
+			{
+				printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
+						jobs[i].job_id, jobs[i].run_time, arrivals[k].priority, jobs[i].job_id);
+				printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+			}
+			else
+			{
+				printf("The scheduler_new_jobs() selected an invalid core (core_id == %d).\n", new_job_core_id);
+				print_available_cores(cores);
+				return 3;
 			}
 		}
 
-
 		/*
 		 * 4. Run the time unit.
 		 */
@@ -386,6 +606,26 @@ int main(int argc, char **argv)
 		for (i = 0; i < cores; i++)
 			time_string[i][0] = '\0';
 
+		if (proportional)
+		{
+			// Every live job is entitled to its weight's share of the cores, at most one
+			int live_tickets = 0;
+			for (i = 0; i < active_jobs; i++)
+				if (jobs[i].arrived)
+					live_tickets += jobs[i].tickets;
+
+			for (i = 0; i < active_jobs; i++)
+			{
+				if (jobs[i].arrived)
+				{
+					float share = (float)cores * jobs[i].tickets / live_tickets;
+					fair_entitled[jobs[i].job_id] += (share > 1.0) ? 1.0 : share;
+					if (jobs[i].core_id != -1)
+						fair_cpu[jobs[i].job_id]++;
+				}
+			}
+		}
+
 		for (i = 0; i < active_jobs; i++)
 		{
 			if (jobs[i].core_id != -1)
@@ -479,14 +719,34 @@ int main(int argc, char **argv)
 	printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time());
 	printf("Average Response Time: %.2f\n", scheduler_average_response_time());
 
+	if (proportional)
+	{
+		printf("\nFairness (cpu received vs. cpu entitled by weight):\n");
+		for (i = 0; i < total_jobs; i++)
+		{
+			trace_record_t r;
+			workload_record(&workload, i, &r);
+			printf("  Job %2d: tickets=%d received=%d entitled=%.2f share=%.2f\n", i, scheduler_tickets(r.priority),
+					fair_cpu[i], fair_entitled[i], fair_entitled[i] > 0 ? fair_cpu[i] / fair_entitled[i] : 0.0);
+		}
+	}
+
+	print_deadline_report(&workload, finish_time, cores);
+
 	scheduler_clean_up();
 
 
+	free(finish_time);
+	free(fair_cpu);
+	free(fair_entitled);
 	free(quantum_clock);
+	free(arrivals);
+	free(arrival_index);
 	for (i=0; i < cores; i++)
 		free(core_timing_diagram[i]);
 	free(core_timing_diagram);
 	free(jobs);
+	workload_close(&workload);
 
 	return 0;
 }
@@ -0,0 +1,294 @@
+/** @file trace.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+
+//byte order helpers, so the format is the same on every host
+static unsigned int get_le32(const unsigned char *p)
+{
+  return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned long long get_le64(const unsigned char *p)
+{
+  return (unsigned long long)get_le32(p) | ((unsigned long long)get_le32(p + 4) << 32);
+}
+
+static void put_le32(unsigned char *p, unsigned int v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+static void put_le64(unsigned char *p, unsigned long long v)
+{
+  put_le32(p, (unsigned int)(v & 0xffffffff));
+  put_le32(p + 4, (unsigned int)(v >> 32));
+}
+
+/**
+  Maps a trace file into memory and validates its header.
+
+  @param t trace to fill in
+  @param path file to open
+  @return 0 on success
+  @return 1 if the file is readable but not a trace, so the caller may try another format
+  @return TRACE_ERR_OPEN if the file cannot be read
+  @return TRACE_ERR_VERSION if the trace has an unknown version or record size
+  @return TRACE_ERR_TRUNCATED if the file holds fewer records than its header says
+ */
+int trace_open(trace_t *t, const char *path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+  {
+    return TRACE_ERR_OPEN;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1)
+  {
+    close(fd);
+    return TRACE_ERR_OPEN;
+  }
+
+  //too small to hold a header, or empty, cannot be a trace
+  if (st.st_size < TRACE_HEADER_SIZE)
+  {
+    close(fd);
+    return 1;
+  }
+
+  void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+  {
+    return TRACE_ERR_OPEN;
+  }
+
+  const unsigned char *header = base;
+  if (memcmp(header, TRACE_MAGIC, 8) != 0)
+  {
+    munmap(base, st.st_size);
+    return 1;
+  }
+
+  unsigned long long count = get_le64(header + 16);
+  if (get_le32(header + 8) != TRACE_VERSION || get_le32(header + 12) != TRACE_RECORD_SIZE)
+  {
+    munmap(base, st.st_size);
+    return TRACE_ERR_VERSION;
+  }
+  if (count > (st.st_size - TRACE_HEADER_SIZE) / TRACE_RECORD_SIZE)
+  {
+    munmap(base, st.st_size);
+    return TRACE_ERR_TRUNCATED;
+  }
+
+  //readers go back to records by index, several times over, so start
+  //reading the whole trace in now and let the kernel keep it cached
+  madvise(base, st.st_size, MADV_WILLNEED);
+
+  t->base = header;
+  t->length = st.st_size;
+  t->count = (long)count;
+  t->seed = get_le64(header + 24);
+  return 0;
+}
+
+/**
+  Decodes one record of a mapped trace.
+
+  @param t an open trace
+  @param index zero-based record number, less than t->count
+  @param r record to fill in
+ */
+void trace_record(const trace_t *t, long index, trace_record_t *r)
+{
+  const unsigned char *p = t->base + TRACE_HEADER_SIZE + (size_t)index * TRACE_RECORD_SIZE;
+  r->arrival_time = (int)get_le32(p);
+  r->run_time = (int)get_le32(p + 4);
+  r->priority = (int)get_le32(p + 8);
+  r->deadline = (int)get_le32(p + 12);
+  r->period = (int)get_le32(p + 16);
+}
+
+/**
+  Unmaps a trace opened with trace_open().
+
+  @param t an open trace
+ */
+void trace_close(trace_t *t)
+{
+  munmap((void *)t->base, t->length);
+  t->base = NULL;
+  t->length = 0;
+  t->count = 0;
+}
+
+/**
+  Reads a whole workload into memory. Binary traces are decoded into the
+  array; any other file is parsed as CSV with a header line followed by
+  arrival time, run time, priority and optional deadline and period columns.
+  Callers that can walk the records in order should use trace_open() instead
+  and read them straight from the mapping.
+
+  @param path file to read
+  @param records set to a malloc'd array of the jobs, in file order
+  @param count set to the number of jobs read
+  @return 0 on success
+  @return a TRACE_ERR_* code otherwise
+ */
+int trace_load(const char *path, trace_record_t **records, long *count)
+{
+  trace_t trace;
+  int status = trace_open(&trace, path);
+  if (status < 0)
+  {
+    return status;
+  }
+
+  if (status == 0)
+  {
+    *records = (trace_record_t *)malloc((trace.count > 0 ? trace.count : 1) * sizeof(trace_record_t));
+    if (*records == NULL)
+    {
+      trace_close(&trace);
+      return TRACE_ERR_MEMORY;
+    }
+    for (long i = 0; i < trace.count; i++)
+    {
+      trace_record(&trace, i, &(*records)[i]);
+    }
+    *count = trace.count;
+    trace_close(&trace);
+    return 0;
+  }
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+  {
+    return TRACE_ERR_OPEN;
+  }
+
+  long capacity = 10;
+  long n = 0;
+  trace_record_t *list = (trace_record_t *)malloc(capacity * sizeof(trace_record_t));
+  char line[1024 + 1];
+  if (list == NULL)
+  {
+    fclose(file);
+    return TRACE_ERR_MEMORY;
+  }
+
+  //ignore the first (header) line
+  if (fgets(line, 1024, file) == NULL)
+  {
+    line[0] = '\0';
+  }
+  while (fgets(line, 1024, file) != NULL)
+  {
+    char *arrival_time = strtok(line, ",");
+    char *run_time = strtok(NULL, ",");
+    char *priority = strtok(NULL, ",");
+    char *deadline = strtok(NULL, ",");
+    char *period = deadline != NULL ? strtok(NULL, ",") : NULL;
+
+    if (arrival_time == NULL || run_time == NULL || priority == NULL)
+    {
+      free(list);
+      fclose(file);
+      return TRACE_ERR_CSV;
+    }
+
+    if (n == capacity)
+    {
+      capacity *= 2;
+      trace_record_t *grown = (trace_record_t *)realloc(list, capacity * sizeof(trace_record_t));
+      if (grown == NULL)
+      {
+        free(list);
+        fclose(file);
+        return TRACE_ERR_MEMORY;
+      }
+      list = grown;
+    }
+
+    list[n].arrival_time = atoi(arrival_time);
+    list[n].run_time = atoi(run_time);
+    list[n].priority = atoi(priority);
+    list[n].deadline = deadline != NULL ? atoi(deadline) : 0;
+    list[n].period = period != NULL ? atoi(period) : 0;
+    n++;
+  }
+
+  fclose(file);
+  *records = list;
+  *count = n;
+  return 0;
+}
+
+/**
+  Describes an error returned by trace_open() or trace_load().
+
+  @param status a TRACE_ERR_* code
+  @return a message for the user
+ */
+const char *trace_error(int status)
+{
+  switch (status)
+  {
+    case TRACE_ERR_CSV:       return "Malformed CSV line in";
+    case TRACE_ERR_MEMORY:    return "Out of memory reading";
+    case TRACE_ERR_VERSION:   return "Unsupported trace version or record size in";
+    case TRACE_ERR_TRUNCATED: return "Truncated trace";
+    default:                  return "Unable to open file";
+  }
+}
+
+/**
+  Writes a trace header.
+
+  @param file stream positioned at the start of the trace
+  @param count number of records that will follow
+  @param seed seed the records were generated with
+  @return 0 on success, -1 on a write error
+ */
+int trace_write_header(FILE *file, long count, unsigned long long seed)
+{
+  unsigned char header[TRACE_HEADER_SIZE];
+  memcpy(header, TRACE_MAGIC, 8);
+  put_le32(header + 8, TRACE_VERSION);
+  put_le32(header + 12, TRACE_RECORD_SIZE);
+  put_le64(header + 16, (unsigned long long)count);
+  put_le64(header + 24, seed);
+  return fwrite(header, TRACE_HEADER_SIZE, 1, file) == 1 ? 0 : -1;
+}
+
+/**
+  Appends one record to a trace.
+
+  @param file stream the header was written to
+  @param r record to write
+  @return 0 on success, -1 on a write error
+ */
+int trace_write_record(FILE *file, const trace_record_t *r)
+{
+  unsigned char record[TRACE_RECORD_SIZE];
+  put_le32(record, (unsigned int)r->arrival_time);
+  put_le32(record + 4, (unsigned int)r->run_time);
+  put_le32(record + 8, (unsigned int)r->priority);
+  put_le32(record + 12, (unsigned int)r->deadline);
+  put_le32(record + 16, (unsigned int)r->period);
+  return fwrite(record, TRACE_RECORD_SIZE, 1, file) == 1 ? 0 : -1;
+}
@@ -0,0 +1,63 @@
+/** @file trace.h
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+  Binary workload trace. A 32 byte header followed by fixed width records,
+  every field a little-endian 32 or 64 bit integer:
+
+    header: magic "SCHTRACE" | u32 version | u32 record size | u64 job count | u64 seed
+    record: i32 arrival time | i32 run time | i32 priority | i32 deadline | i32 period
+
+  Records are stored in arrival order. A deadline or period of 0 means none.
+*/
+#define TRACE_MAGIC       "SCHTRACE"
+#define TRACE_VERSION     1
+#define TRACE_HEADER_SIZE 32
+#define TRACE_RECORD_SIZE 20
+
+/**
+  Errors returned by trace_open() and trace_load(); trace_error() describes them.
+*/
+#define TRACE_ERR_OPEN      -1 //file cannot be opened or mapped
+#define TRACE_ERR_CSV       -2 //a CSV line is malformed
+#define TRACE_ERR_MEMORY    -3 //out of memory
+#define TRACE_ERR_VERSION   -4 //trace version or record size is not supported
+#define TRACE_ERR_TRUNCATED -5 //header promises more records than the file holds
+
+typedef struct _trace_record_t
+{
+  int arrival_time;
+  int run_time;
+  int priority;
+  int deadline; //relative to arrival, 0 if none
+  int period;   //0 if none
+} trace_record_t;
+
+/**
+  A trace mapped into memory for reading.
+*/
+typedef struct _trace_t
+{
+  const unsigned char *base; //start of the mapping
+  size_t length;             //bytes mapped
+  long count;                //number of records
+  unsigned long long seed;   //seed the trace was generated with
+} trace_t;
+
+int  trace_open        (trace_t *t, const char *path);
+void trace_record      (const trace_t *t, long index, trace_record_t *r);
+void trace_close       (trace_t *t);
+
+int  trace_load        (const char *path, trace_record_t **records, long *count);
+const char *trace_error(int status);
+
+int  trace_write_header(FILE *file, long count, unsigned long long seed);
+int  trace_write_record(FILE *file, const trace_record_t *r);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,179 @@
+/** @file tracegen.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <math.h>
+
+#include "trace/trace.h"
+
+#define MAX_PRIORITIES 64
+
+void print_usage(char *program_name)
+{
+	fprintf(stderr, "Usage: %s -n <jobs> [options] <output file>\n", program_name);
+	fprintf(stderr, "       %s -n 1000000 -s 42 -r 0.8 -a 1.5 -p 1:6,2:3,3:1 big.trace\n", program_name);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "  -s <seed>     random seed, equal seeds give identical traces (default 1)\n");
+	fprintf(stderr, "  -r <rate>     Poisson arrival rate in jobs per time unit (default 0.5)\n");
+	fprintf(stderr, "  -a <alpha>    Pareto shape of the run times, lower is heavier tailed (default 1.5)\n");
+	fprintf(stderr, "  -m <min>      smallest run time (default 1)\n");
+	fprintf(stderr, "  -M <max>      largest run time, the tail is clipped here (default 1000)\n");
+	fprintf(stderr, "  -p <mix>      priority:weight list (default 1:1,2:1,3:1,4:1,5:1)\n");
+	fprintf(stderr, "  -d <factor>   give each job a deadline of factor * run time (default none)\n");
+	fprintf(stderr, "  -f csv        write the simulator's CSV format instead of a binary trace\n");
+}
+
+/*
+ * splitmix64, small and identical on every platform so seeds reproduce exactly
+ */
+unsigned long long rng_state;
+
+unsigned long long rng_next()
+{
+	unsigned long long z = (rng_state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// Uniform on (0, 1]
+double rng_uniform()
+{
+	return ((rng_next() >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+int main(int argc, char **argv)
+{
+	int c, i;
+	long jobs = 0;
+	unsigned long long seed = 1;
+	double rate = 0.5, alpha = 1.5, deadline_factor = 0.0;
+	int run_min = 1, run_max = 1000, csv = 0;
+	char *mix = "1:1,2:1,3:1,4:1,5:1";
+
+	while ((c = getopt(argc, argv, "n:s:r:a:m:M:p:d:f:")) != -1)
+	{
+		switch (c)
+		{
+			case 'n': jobs = atol(optarg); break;
+			case 's': seed = strtoull(optarg, NULL, 10); break;
+			case 'r': rate = atof(optarg); break;
+			case 'a': alpha = atof(optarg); break;
+			case 'm': run_min = atoi(optarg); break;
+			case 'M': run_max = atoi(optarg); break;
+			case 'p': mix = optarg; break;
+			case 'd': deadline_factor = atof(optarg); break;
+			case 'f':
+				if (strcasecmp(optarg, "csv") != 0)
+				{
+					fprintf(stderr, "Option -f only accepts csv.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				csv = 1;
+				break;
+
+			case '?':
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (jobs <= 0 || rate <= 0.0 || alpha <= 0.0 || run_min <= 0 || run_max < run_min || optind != argc - 1)
+	{
+		fprintf(stderr, "A positive job count, rate, shape and run time range and a single output file are required.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	/*
+	 * Parse the priority mix into a cumulative weight table.
+	 */
+	int priorities[MAX_PRIORITIES];
+	double cumulative[MAX_PRIORITIES];
+	int n_priorities = 0;
+	double total_weight = 0.0;
+	char *mix_copy = strdup(mix);
+	char *entry;
+	for (entry = strtok(mix_copy, ","); entry != NULL; entry = strtok(NULL, ","))
+	{
+		char *colon = strchr(entry, ':');
+		double weight = colon != NULL ? atof(colon + 1) : 1.0;
+		if (n_priorities == MAX_PRIORITIES || weight <= 0.0)
+		{
+			fprintf(stderr, "Illegal priority mix \"%s\".\n", mix);
+			return 1;
+		}
+		priorities[n_priorities] = atoi(entry);
+		total_weight += weight;
+		cumulative[n_priorities++] = total_weight;
+	}
+	free(mix_copy);
+
+	if (n_priorities == 0)
+	{
+		fprintf(stderr, "Illegal priority mix \"%s\".\n", mix);
+		return 1;
+	}
+
+	FILE *file = fopen(argv[optind], "w");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Unable to open file \"%s\".\n", argv[optind]);
+		return 2;
+	}
+	setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+	if (csv)
+		fprintf(file, "\"Arrival time\",\"Run time\",\"Priority\",\"Deadline\",\"Period\"\n");
+	else
+		trace_write_header(file, jobs, seed);
+
+	/*
+	 * Generate the jobs: exponential gaps between arrivals, Pareto run times.
+	 */
+	rng_state = seed;
+	double clock = 0.0;
+	long n;
+	for (n = 0; n < jobs; n++)
+	{
+		trace_record_t r;
+
+		r.arrival_time = (int)clock;
+		clock += -log(rng_uniform()) / rate;
+
+		double run = run_min / pow(rng_uniform(), 1.0 / alpha);
+		r.run_time = run > run_max ? run_max : (int)run;
+
+		double pick = rng_uniform() * total_weight;
+		for (i = 0; i < n_priorities - 1 && pick > cumulative[i]; i++)
+			;
+		r.priority = priorities[i];
+
+		r.deadline = deadline_factor > 0.0 ? (int)ceil(r.run_time * deadline_factor) : 0;
+		r.period = 0;
+
+		int error;
+		if (csv)
+			error = fprintf(file, "%d,%d,%d,%d,%d\n", r.arrival_time, r.run_time, r.priority, r.deadline, r.period) < 0;
+		else
+			error = trace_write_record(file, &r);
+
+		if (error)
+		{
+			fprintf(stderr, "Unable to write \"%s\".\n", argv[optind]);
+			return 2;
+		}
+	}
+
+	if (fclose(file) != 0)
+	{
+		fprintf(stderr, "Unable to write \"%s\".\n", argv[optind]);
+		return 2;
+	}
+
+	return 0;
+}